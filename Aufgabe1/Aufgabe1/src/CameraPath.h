@@ -0,0 +1,429 @@
+#ifndef CAMERAPATH_H
+#define CAMERAPATH_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+#include "Spline.h"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// camera state produced by one simulation step
+struct CameraState
+{
+	float distance = 0.0f;
+	glm::vec3 position = glm::vec3(0.0f);
+	glm::quat orientation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+};
+
+// blend two simulation states for rendering, alpha = 0 gives previous, alpha = 1 gives current
+inline CameraState mixCameraState(const CameraState& previous, const CameraState& current, float alpha)
+{
+	CameraState result;
+	result.distance = glm::mix(previous.distance, current.distance, alpha);
+	result.position = glm::mix(previous.position, current.position, alpha);
+	result.orientation = glm::slerp(previous.orientation, current.orientation, alpha);
+	return result;
+}
+
+// key frames of a camera path as structure of arrays, the arrays can live in a memory mapped file
+struct PathKeys
+{
+	int count = 0;
+	const float* px = nullptr;
+	const float* py = nullptr;
+	const float* pz = nullptr;
+	const float* qw = nullptr;
+	const float* qx = nullptr;
+	const float* qy = nullptr;
+	const float* qz = nullptr;
+	// optional per key tension, bias and continuity, all zero when missing
+	const float* tension = nullptr;
+	const float* bias = nullptr;
+	const float* continuity = nullptr;
+
+	glm::vec3 position(int i) const
+	{
+		return glm::vec3(px[i], py[i], pz[i]);
+	}
+
+	glm::quat orientation(int i) const
+	{
+		return glm::quat(qw[i], qx[i], qy[i], qz[i]);
+	}
+
+	glm::vec3 tcb(int i) const
+	{
+		return tension ? glm::vec3(tension[i], bias[i], continuity[i]) : glm::vec3(0.0f);
+	}
+};
+
+// Kochanek-Bartels camera path reparameterized by arc length.
+// Segment i runs from key i + 1 to key i + 2 (the first and last key only shape the tangents),
+// so a path with n keys has n - 3 segments, the same ones the old index loop walked through.
+// Segments are converted lazily into cubic polynomial coefficients, squad control quaternions and
+// a table of accumulated lengths, held in a window of slots (structure of arrays, slot = segment
+// modulo window size). The path length is accumulated as far as the path has been walked; start
+// distances are kept for the segments in the window and in a checkpoint every CHECKPOINT_SPACING
+// segments, so neither startup time nor resident memory depends on the number of keys.
+// A distance is mapped to (segment, t) by walking forward from the last located segment (or the
+// nearest checkpoint before it), a binary search in the arc length table and a linear interpolation,
+// evaluating it is a Horner scheme plus squad without any allocation.
+// The segment cache is filled from const methods, a CameraPath must not be shared between threads.
+class CameraPath
+{
+public:
+	// one float stream per coefficient, each stream holds one value per window slot
+	enum Stream
+	{
+		// position = ((a * t + b) * t + c) * t + d
+		AX, AY, AZ, BX, BY, BZ, CX, CY, CZ, DX, DY, DZ,
+		// squad(q0, q1, s0, s1, t)
+		Q0W, Q0X, Q0Y, Q0Z, Q1W, Q1X, Q1Y, Q1Z,
+		S0W, S0X, S0Y, S0Z, S1W, S1X, S1Y, S1Z,
+		STREAM_COUNT
+	};
+
+	// segments between two stored start distances
+	static const int CHECKPOINT_SPACING = 1024;
+
+	// path from key arrays, the keys are copied
+	CameraPath(const glm::vec3 positions[], const glm::quat orientations[], int keyCount, int samplesPerSegment = 32, int windowSize = 256)
+	{
+		ownedKeys.resize(7 * keyCount);
+		PathKeys view;
+		view.count = keyCount;
+		float* streams[7];
+		for (int k = 0; k < 7; k++)
+			streams[k] = &ownedKeys[k * keyCount];
+		for (int i = 0; i < keyCount; i++)
+		{
+			streams[0][i] = positions[i].x;
+			streams[1][i] = positions[i].y;
+			streams[2][i] = positions[i].z;
+			streams[3][i] = orientations[i].w;
+			streams[4][i] = orientations[i].x;
+			streams[5][i] = orientations[i].y;
+			streams[6][i] = orientations[i].z;
+		}
+		view.px = streams[0];
+		view.py = streams[1];
+		view.pz = streams[2];
+		view.qw = streams[3];
+		view.qx = streams[4];
+		view.qy = streams[5];
+		view.qz = streams[6];
+		init(view, samplesPerSegment, windowSize);
+	}
+
+	// path over external keys (e.g. a mapped path file), the arrays must outlive the path
+	CameraPath(const PathKeys& pathKeys, int samplesPerSegment = 32, int windowSize = 256)
+	{
+		init(pathKeys, samplesPerSegment, windowSize);
+	}
+
+	// keys may point into ownedKeys, moving keeps that buffer, copying wouldn't
+	CameraPath(const CameraPath&) = delete;
+	CameraPath& operator=(const CameraPath&) = delete;
+	CameraPath(CameraPath&&) = default;
+	CameraPath& operator=(CameraPath&&) = default;
+
+	// total length of the path in world units, walks all remaining segments the first time
+	float length() const
+	{
+		extend(std::numeric_limits<float>::infinity());
+		return walkedLength;
+	}
+
+	int segmentCount() const
+	{
+		return count;
+	}
+
+	int windowSize() const
+	{
+		return window;
+	}
+
+	// average length of the first few segments, cheap estimate for speeds on long paths
+	float averageSegmentLength(int segmentsToMeasure = 64) const
+	{
+		int n = std::min(segmentsToMeasure, count);
+		float sum = 0.0f;
+		for (int i = 0; i < n; i++)
+			sum += segmentLength(i);
+		return n > 0 ? sum / n : 0.0f;
+	}
+
+	float segmentLength(int segment) const
+	{
+		return arcTable[resolve(segment) * (samples + 1) + samples];
+	}
+
+	// true if s lies behind the end of the path, only looks at segments up to s
+	bool pastEnd(float s) const
+	{
+		extend(s);
+		return walked == count && s >= walkedLength;
+	}
+
+	// window slot holding the segment, computes the segment if it isn't resident
+	int resolve(int segment) const
+	{
+		int slot = segment % window;
+		if (slotSegment[slot] != segment)
+			computeSegment(slot, segment);
+		return slot;
+	}
+
+	// true if the slot currently holds the segment
+	bool isResident(int segment, int slot) const
+	{
+		return slotSegment[slot] == segment;
+	}
+
+	// coefficient stream of all window slots, see Stream and resolve()
+	const float* stream(Stream s) const
+	{
+		return &coefficients[s * window];
+	}
+
+	// map a distance along the path to a segment and its local spline parameter, distances wrap around
+	void locate(float s, int& segment, float& t) const
+	{
+		if (count == 0)
+		{
+			segment = 0;
+			t = 0.0f;
+			return;
+		}
+		if (s < 0.0f || pastEnd(s))
+		{
+			float total = length();
+			if (total <= 0.0f)
+			{
+				segment = 0;
+				t = 0.0f;
+				return;
+			}
+			s = std::fmod(s, total);
+			if (s < 0.0f)
+				s += total;
+		}
+		extend(s);
+
+		// find the segment containing s among the segments walked so far
+		float start;
+		findSegment(s, segment, start);
+		float local = s - start;
+
+		// find the sample interval inside the segment and interpolate between its ends
+		const float* table = &arcTable[resolve(segment) * (samples + 1)];
+		int j = (int)(std::upper_bound(table, table + samples + 1, local) - table) - 1;
+		j = std::min(std::max(j, 0), samples - 1);
+		float span = table[j + 1] - table[j];
+		float fraction = span > 0.0f ? (local - table[j]) / span : 0.0f;
+		t = (j + fraction) / samples;
+	}
+
+	// position and orientation at distance s along the path
+	void sample(float s, glm::vec3& position, glm::quat& orientation) const
+	{
+		int segment;
+		float t;
+		locate(s, segment, t);
+		evaluate(segment, t, position, orientation);
+	}
+
+	// position and orientation at spline parameter t of a segment
+	void evaluate(int segment, float t, glm::vec3& position, glm::quat& orientation) const
+	{
+		int slot = resolve(segment);
+		position = positionAt(slot, t);
+		orientation = glm::squad(getQuat(Q0W, slot), getQuat(Q1W, slot), getQuat(S0W, slot), getQuat(S1W, slot), t);
+	}
+
+	glm::vec3 evaluatePosition(int segment, float t) const
+	{
+		return positionAt(resolve(segment), t);
+	}
+
+private:
+	void init(const PathKeys& pathKeys, int samplesPerSegment, int windowSize)
+	{
+		keys = pathKeys;
+		samples = samplesPerSegment;
+		count = std::max(keys.count - 3, 0);
+		window = std::max(std::min(windowSize, count), 1);
+		coefficients.resize(STREAM_COUNT * window);
+		arcTable.resize(window * (samples + 1));
+		slotSegment.assign(window, -1);
+		startSegment.assign(window, -1);
+		startDistance.assign(window, 0.0f);
+		checkpoints.assign(1, 0.0f);
+		walked = 0;
+		walkedLength = 0.0f;
+		cursor = -1;
+	}
+
+	// convert one segment into coefficients and its arc length table
+	void computeSegment(int slot, int segment) const
+	{
+		int i = segment;
+		glm::vec3 p0 = keys.position(i + 1);
+		glm::vec3 p1 = keys.position(i + 2);
+		glm::vec3 tang1, tang2;
+		calcTangents(keys.position(i), p0, p1, keys.position(i + 3), tang1, tang2, keys.tcb(i + 1), keys.tcb(i + 2));
+		// calcPoint expanded into powers of t
+		setVec3(AX, slot, 2.0f * (p0 - p1) + tang1 + tang2);
+		setVec3(BX, slot, 3.0f * (p1 - p0) - 2.0f * tang1 - tang2);
+		setVec3(CX, slot, tang1);
+		setVec3(DX, slot, p0);
+		// helper quats for the squad interpolation only depend on the keys
+		glm::quat q0 = keys.orientation(i + 1);
+		glm::quat q1 = keys.orientation(i + 2);
+		setQuat(Q0W, slot, q0);
+		setQuat(Q1W, slot, q1);
+		setQuat(S0W, slot, glm::intermediate(keys.orientation(i), q0, q1));
+		setQuat(S1W, slot, glm::intermediate(q0, q1, keys.orientation(i + 3)));
+		slotSegment[slot] = segment;
+
+		// accumulated chord length along the segment
+		float* table = &arcTable[slot * (samples + 1)];
+		table[0] = 0.0f;
+		glm::vec3 last = p0;
+		for (int j = 1; j <= samples; j++)
+		{
+			glm::vec3 point = positionAt(slot, (float)j / samples);
+			table[j] = table[j - 1] + glm::length(point - last);
+			last = point;
+		}
+	}
+
+	// accumulate segment lengths until s is covered or the path ends, storing a checkpoint every CHECKPOINT_SPACING segments
+	void extend(float s) const
+	{
+		while (walked < count && walkedLength <= s)
+		{
+			walkedLength += segmentLength(walked);
+			walked++;
+			if (walked % CHECKPOINT_SPACING == 0 && walked < count)
+				checkpoints.push_back(walkedLength);
+		}
+	}
+
+	// start distance of the segment if it is stored in the window
+	bool knownStart(int segment, float& start) const
+	{
+		int slot = segment % window;
+		if (startSegment[slot] != segment)
+			return false;
+		start = startDistance[slot];
+		return true;
+	}
+
+	void storeStart(int segment, float start) const
+	{
+		int slot = segment % window;
+		startSegment[slot] = segment;
+		startDistance[slot] = start;
+	}
+
+	// last walked segment starting at or before s, s must be covered by extend()
+	// starts from the last located segment (stepping back through the window if needed) or from the checkpoint before s
+	// and walks forward, the sums run in the same order as in extend() so every start distance is the same
+	void findSegment(float s, int& segment, float& start) const
+	{
+		int block = (int)(std::upper_bound(checkpoints.begin(), checkpoints.end(), s) - checkpoints.begin()) - 1;
+		block = std::max(block, 0);
+		segment = block * CHECKPOINT_SPACING;
+		start = checkpoints[block];
+
+		int candidate = cursor;
+		float candidateStart;
+		while (candidate > segment && knownStart(candidate, candidateStart))
+		{
+			if (candidateStart <= s)
+			{
+				segment = candidate;
+				start = candidateStart;
+				break;
+			}
+			candidate--;
+		}
+
+		storeStart(segment, start);
+		while (segment + 1 < walked)
+		{
+			float next = start + segmentLength(segment);
+			if (next > s)
+				break;
+			segment++;
+			start = next;
+			storeStart(segment, start);
+		}
+		cursor = segment;
+	}
+
+	glm::vec3 positionAt(int slot, float t) const
+	{
+		glm::vec3 a = getVec3(AX, slot);
+		glm::vec3 b = getVec3(BX, slot);
+		glm::vec3 c = getVec3(CX, slot);
+		glm::vec3 d = getVec3(DX, slot);
+		return ((a * t + b) * t + c) * t + d;
+	}
+
+	void setVec3(int first, int slot, const glm::vec3& v) const
+	{
+		for (int k = 0; k < 3; k++)
+			coefficients[(first + k) * window + slot] = v[k];
+	}
+
+	void setQuat(int first, int slot, const glm::quat& q) const
+	{
+		coefficients[first * window + slot] = q.w;
+		coefficients[(first + 1) * window + slot] = q.x;
+		coefficients[(first + 2) * window + slot] = q.y;
+		coefficients[(first + 3) * window + slot] = q.z;
+	}
+
+	glm::vec3 getVec3(int first, int slot) const
+	{
+		return glm::vec3(coefficients[first * window + slot], coefficients[(first + 1) * window + slot], coefficients[(first + 2) * window + slot]);
+	}
+
+	glm::quat getQuat(int first, int slot) const
+	{
+		return glm::quat(coefficients[first * window + slot], coefficients[(first + 1) * window + slot],
+			coefficients[(first + 2) * window + slot], coefficients[(first + 3) * window + slot]);
+	}
+
+	PathKeys keys;
+	// key storage when the path was built from arrays
+	std::vector<float> ownedKeys;
+	int samples = 32;
+	int count = 0;
+	int window = 1;
+
+	// segment cache: STREAM_COUNT streams of window floats, samples + 1 accumulated lengths per slot
+	mutable std::vector<float> coefficients;
+	mutable std::vector<float> arcTable;
+	mutable std::vector<int> slotSegment;
+	// start distances of the segments last walked over, slot = segment modulo window size
+	mutable std::vector<int> startSegment;
+	mutable std::vector<float> startDistance;
+	// start distance of every CHECKPOINT_SPACING-th segment
+	mutable std::vector<float> checkpoints;
+	// segments accumulated by extend() and their total length
+	mutable int walked = 0;
+	mutable float walkedLength = 0.0f;
+	// segment found by the last locate, walks usually continue from there
+	mutable int cursor = -1;
+};
+
+#endif
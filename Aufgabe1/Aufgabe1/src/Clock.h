@@ -0,0 +1,99 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <chrono>
+
+// Animation clock with a fixed simulation step.
+// Every frame advance() measures the elapsed real time (scaled by the time scale), adds it to an
+// accumulator and returns how many fixed steps the simulation has to run. alpha() is the remaining
+// fraction of a step, used to interpolate between the last two simulation states when rendering.
+// In deterministic mode every frame adds the same frame delta instead of the measured time, so the
+// same frame sequence is produced on every machine.
+class Clock
+{
+public:
+	Clock(double fixedStep = 1.0 / 120.0, int maxStepsPerFrame = 8)
+		: step(fixedStep), maxSteps(maxStepsPerFrame)
+	{
+		last = now();
+	}
+
+	// monotonic time in seconds
+	static double now()
+	{
+		typedef std::chrono::steady_clock clock;
+		return std::chrono::duration<double>(clock::now().time_since_epoch()).count();
+	}
+
+	// advance by one rendered frame, returns the number of fixed steps to simulate
+	int advance()
+	{
+		double current = now();
+		double delta = deterministic ? frameDelta : current - last;
+		last = current;
+
+		accumulator += delta * scale;
+		// small epsilon so exact multiples of the step (deterministic mode) don't round down
+		int steps = (int)(accumulator / step + 1e-9);
+		// don't try to catch up after a long stall (debugger, window drag), drop the backlog instead.
+		// Deterministic frames never stall, they always run every step so the path keeps the requested rate.
+		if (!deterministic && steps > maxSteps)
+		{
+			steps = maxSteps;
+			accumulator = 0.0;
+		}
+		else
+		{
+			accumulator -= steps * step;
+		}
+		simTime += steps * step;
+		return steps;
+	}
+
+	// interpolation factor between the previous and the current simulation state
+	double alpha() const
+	{
+		return accumulator > 0.0 ? accumulator / step : 0.0;
+	}
+
+	double stepSize() const
+	{
+		return step;
+	}
+
+	// simulated time in seconds
+	double time() const
+	{
+		return simTime;
+	}
+
+	void setTimeScale(double timeScale)
+	{
+		scale = timeScale;
+	}
+
+	double timeScale() const
+	{
+		return scale;
+	}
+
+	// every frame advances exactly delta seconds of (unscaled) time, independent of the real frame time
+	void setDeterministic(double delta)
+	{
+		deterministic = true;
+		frameDelta = delta;
+		accumulator = 0.0;
+	}
+
+private:
+	double step;
+	int maxSteps;
+	double last = 0.0;
+	double accumulator = 0.0;
+	double simTime = 0.0;
+	double scale = 1.0;
+	bool deterministic = false;
+	double frameDelta = 0.0;
+};
+
+#endif
@@ -0,0 +1,196 @@
+#include "CpuProfiler.h"
+
+#ifdef EZG_PROFILE
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace cpuprofiler
+{
+	namespace
+	{
+		// how often the flush thread empties the rings
+		const std::chrono::milliseconds FLUSH_INTERVAL(5);
+		// how long the tick length is measured
+		const std::chrono::milliseconds CALIBRATION_TIME(20);
+
+		struct Registry
+		{
+			std::mutex mutex;
+			std::vector<ThreadBuffer*> buffers;
+			std::vector<std::string> names;
+			std::thread flusher;
+			std::condition_variable wake;
+			bool running = false;
+			FILE* file = nullptr;
+			bool firstEvent = true;
+			int64_t origin = 0;
+			double tickLength = 1.0;
+		};
+
+		Registry& registry()
+		{
+			static Registry r;
+			return r;
+		}
+
+		// new ignores alignas above the default alignment before C++17, the thread buffers are placed by hand.
+		// They are never freed.
+		void* allocateAligned(size_t size, size_t alignment)
+		{
+#ifdef _WIN32
+			void* memory = _aligned_malloc(size, alignment);
+#else
+			void* memory = nullptr;
+			if (posix_memalign(&memory, alignment, size) != 0)
+				memory = nullptr;
+#endif
+			if (memory == nullptr)
+				throw std::bad_alloc();
+			return memory;
+		}
+
+		void writeEvent(Registry& r, const Event& e, int tid)
+		{
+			// microseconds with ns precision
+			std::fprintf(r.file, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+				r.firstEvent ? "" : ",", e.name, tid, (e.begin - r.origin) * r.tickLength / 1000.0, (e.end - e.begin) * r.tickLength / 1000.0);
+			r.firstEvent = false;
+		}
+
+		// moves everything that is in the rings into the file, called by the flush thread only
+		void drain(Registry& r)
+		{
+			std::vector<ThreadBuffer*> buffers;
+			{
+				std::lock_guard<std::mutex> lock(r.mutex);
+				buffers = r.buffers;
+			}
+			for (ThreadBuffer* buffer : buffers)
+			{
+				uint32_t tail = buffer->tail.load(std::memory_order_relaxed);
+				uint32_t head = buffer->head.load(std::memory_order_acquire);
+				for (; tail != head; tail++)
+				{
+					const Event& e = buffer->events[tail & (ThreadBuffer::CAPACITY - 1)];
+					// zones from before the trace was started
+					if (e.begin >= r.origin)
+						writeEvent(r, e, buffer->id);
+				}
+				buffer->tail.store(tail, std::memory_order_release);
+			}
+		}
+
+		void flushLoop()
+		{
+			Registry& r = registry();
+			std::unique_lock<std::mutex> lock(r.mutex);
+			while (r.running)
+			{
+				r.wake.wait_for(lock, FLUSH_INTERVAL);
+				lock.unlock();
+				drain(r);
+				lock.lock();
+			}
+		}
+	}
+
+	double nanosecondsPerTick()
+	{
+#ifdef CPUPROFILER_RDTSC
+		static const double length = []() {
+			auto clockBegin = std::chrono::steady_clock::now();
+			int64_t ticksBegin = now();
+			std::this_thread::sleep_for(CALIBRATION_TIME);
+			auto clockEnd = std::chrono::steady_clock::now();
+			int64_t ticksEnd = now();
+			return std::chrono::duration<double, std::nano>(clockEnd - clockBegin).count() / (double)(ticksEnd - ticksBegin);
+		}();
+		return length;
+#else
+		return 1.0;
+#endif
+	}
+
+	ThreadBuffer* registerThread()
+	{
+		Registry& r = registry();
+		ThreadBuffer* buffer = new (allocateAligned(sizeof(ThreadBuffer), alignof(ThreadBuffer))) ThreadBuffer();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		buffer->id = (int)r.buffers.size() + 1;
+		r.buffers.push_back(buffer);
+		r.names.push_back("thread " + std::to_string(buffer->id));
+		return buffer;
+	}
+
+	void setThreadName(const char* name)
+	{
+		int id = threadBuffer().id;
+		Registry& r = registry();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		r.names[id - 1] = name;
+	}
+
+	bool start(const char* path)
+	{
+		Registry& r = registry();
+		// before taking the lock, the first call sleeps for the calibration
+		double tickLength = nanosecondsPerTick();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		if (r.running)
+			return false;
+		r.file = std::fopen(path, "w");
+		if (r.file == nullptr)
+			return false;
+		std::fprintf(r.file, "{\"traceEvents\":[");
+		for (ThreadBuffer* buffer : r.buffers)
+			buffer->dropped.store(0);
+		r.firstEvent = true;
+		r.tickLength = tickLength;
+		r.origin = now();
+		r.running = true;
+		r.flusher = std::thread(flushLoop);
+		return true;
+	}
+
+	void stop()
+	{
+		Registry& r = registry();
+		{
+			std::lock_guard<std::mutex> lock(r.mutex);
+			if (!r.running)
+				return;
+			r.running = false;
+		}
+		r.wake.notify_one();
+		r.flusher.join();
+		drain(r);
+
+		std::lock_guard<std::mutex> lock(r.mutex);
+		uint32_t dropped = 0;
+		for (size_t i = 0; i < r.buffers.size(); i++)
+		{
+			std::fprintf(r.file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+				r.firstEvent ? "" : ",", r.buffers[i]->id, r.names[i].c_str());
+			r.firstEvent = false;
+			dropped += r.buffers[i]->dropped.load();
+		}
+		std::fprintf(r.file, "\n]}\n");
+		std::fclose(r.file);
+		r.file = nullptr;
+		if (dropped > 0)
+			std::printf("cpu profiler: %u zones dropped, the flush thread did not keep up\n", dropped);
+	}
+}
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef CPUPROFILER_H
+#define CPUPROFILER_H
+
+// Scoped CPU zones for frame timelines, written as Chrome trace events (open the file in Perfetto or chrome://tracing).
+// PROFILE_ZONE("name") measures the enclosing scope, the name has to be a string literal.
+// Zones record raw time stamp counter ticks, they are converted to ns only when the trace is written.
+// Every thread writes its zones into its own ring buffer (single producer, single consumer, no locks),
+// a flush thread started with PROFILE_START(path) empties the rings into the file until PROFILE_STOP().
+// Everything compiles to nothing unless EZG_PROFILE is defined, PROFILE_START is then always false.
+
+#ifdef EZG_PROFILE
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define CPUPROFILER_RDTSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CPUPROFILER_RDTSC
+#endif
+
+namespace cpuprofiler
+{
+	struct Event
+	{
+		const char* name;
+		int64_t begin;
+		int64_t end;
+	};
+
+	// time stamp counter ticks (invariant on every x64 CPU the project targets), steady clock ns elsewhere
+	inline int64_t now()
+	{
+#ifdef CPUPROFILER_RDTSC
+		return (int64_t)__rdtsc();
+#else
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	// length of one now() tick, measured against the steady clock on the first call
+	double nanosecondsPerTick();
+
+	// zones of one thread, only written by that thread and only read by the flush thread
+	struct ThreadBuffer
+	{
+		static const uint32_t CAPACITY = 1 << 16;
+
+		Event events[CAPACITY];
+		// on separate cache lines, head is written by the owning thread and tail by the flush thread
+		alignas(64) std::atomic<uint32_t> head{ 0 };
+		alignas(64) std::atomic<uint32_t> tail{ 0 };
+		// zones lost because the flush thread didn't keep up
+		std::atomic<uint32_t> dropped{ 0 };
+		int id = 0;
+
+		void push(const char* name, int64_t begin, int64_t end)
+		{
+			uint32_t h = head.load(std::memory_order_relaxed);
+			if (h - tail.load(std::memory_order_acquire) == CAPACITY)
+			{
+				dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			Event& e = events[h & (CAPACITY - 1)];
+			e.name = name;
+			e.begin = begin;
+			e.end = end;
+			head.store(h + 1, std::memory_order_release);
+		}
+	};
+
+	// creates and registers the buffer of the calling thread, buffers live until the program ends
+	ThreadBuffer* registerThread();
+
+	inline ThreadBuffer& threadBuffer()
+	{
+		thread_local ThreadBuffer* buffer = registerThread();
+		return *buffer;
+	}
+
+	// shown as the thread name in the trace
+	void setThreadName(const char* name);
+	// starts the flush thread writing to path, false if the file can't be created or it is already running
+	bool start(const char* path);
+	// writes the remaining zones, closes the file and joins the flush thread
+	void stop();
+
+	class Zone
+	{
+	public:
+		explicit Zone(const char* name)
+			: name(name), begin(now())
+		{
+		}
+
+		~Zone()
+		{
+			threadBuffer().push(name, begin, now());
+		}
+
+		Zone(const Zone&) = delete;
+		Zone& operator=(const Zone&) = delete;
+
+	private:
+		const char* name;
+		int64_t begin;
+	};
+}
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) cpuprofiler::Zone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_THREAD(name) cpuprofiler::setThreadName(name)
+#define PROFILE_START(path) cpuprofiler::start(path)
+#define PROFILE_STOP() cpuprofiler::stop()
+
+#else
+
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+#define PROFILE_START(path) ((void)(path), false)
+#define PROFILE_STOP() ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,239 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CULLING_SSE
+#endif
+
+// Frustum culling of axis aligned boxes.
+// The boxes are stored as SoA (one array per min/max component) and tested in blocks of 8 against
+// the planes of one or more frusta: 8 wide AVX2 (/arch:AVX2 or -mavx2), two 4 wide halves with SSE,
+// plain floats otherwise. The result is a bit mask, one bit per box.
+
+// planes (a, b, c, d) with a * x + b * y + c * z + d >= 0 on the inside, taken from a (view) projection matrix
+struct Frustum
+{
+	glm::vec4 planes[6];
+
+	Frustum()
+	{
+	}
+
+	explicit Frustum(const glm::mat4& m)
+	{
+		// rows of the matrix, glm stores columns
+		glm::vec4 x(m[0][0], m[1][0], m[2][0], m[3][0]);
+		glm::vec4 y(m[0][1], m[1][1], m[2][1], m[3][1]);
+		glm::vec4 z(m[0][2], m[1][2], m[2][2], m[3][2]);
+		glm::vec4 w(m[0][3], m[1][3], m[2][3], m[3][3]);
+		planes[0] = w + x;
+		planes[1] = w - x;
+		planes[2] = w + y;
+		planes[3] = w - y;
+		planes[4] = w + z;
+		planes[5] = w - z;
+	}
+};
+
+// world space bounds of a local box after model (transforms the center and the extent)
+inline void transformBounds(const glm::mat4& model, const glm::vec3& min, const glm::vec3& max, glm::vec3& outMin, glm::vec3& outMax)
+{
+	glm::vec3 center = glm::vec3(model * glm::vec4((min + max) * 0.5f, 1.0f));
+	glm::vec3 half = (max - min) * 0.5f;
+	glm::mat3 m(model);
+	glm::vec3 extent = glm::abs(m[0]) * half.x + glm::abs(m[1]) * half.y + glm::abs(m[2]) * half.z;
+	outMin = center - extent;
+	outMax = center + extent;
+}
+
+class Culler
+{
+public:
+	static const int BLOCK = 8;
+
+	// returns the index of the box, the same index is used in the visibility mask
+	unsigned int add(const glm::vec3& min, const glm::vec3& max)
+	{
+		if (count % BLOCK == 0)
+			for (int c = 0; c < 6; c++)
+				bounds[c].resize(count + BLOCK, 0.0f);
+		set(count, min, max);
+		return (unsigned int)count++;
+	}
+
+	// moves a box (dynamic objects)
+	void set(size_t i, const glm::vec3& min, const glm::vec3& max)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			bounds[c][i] = min[c];
+			bounds[3 + c][i] = max[c];
+		}
+	}
+
+	void clear()
+	{
+		for (int c = 0; c < 6; c++)
+			bounds[c].clear();
+		count = 0;
+	}
+
+	size_t size() const
+	{
+		return count;
+	}
+
+	// a box is visible if it is at least partly inside one of the frusta (several shadow cascades),
+	// bit i % 8 of visible[i / 8] is set for visible boxes, returns the number of visible boxes
+	size_t cull(const Frustum* frusta, int frustumCount, std::vector<uint8_t>& visible) const
+	{
+		return cullBlocks<false>(frusta, frustumCount, visible);
+	}
+
+	size_t cull(const Frustum& frustum, std::vector<uint8_t>& visible) const
+	{
+		return cull(&frustum, 1, visible);
+	}
+
+	// one box at a time, reference for the benchmark
+	size_t cullScalar(const Frustum* frusta, int frustumCount, std::vector<uint8_t>& visible) const
+	{
+		return cullBlocks<true>(frusta, frustumCount, visible);
+	}
+
+	static bool isVisible(const std::vector<uint8_t>& visible, size_t i)
+	{
+		return (visible[i / BLOCK] >> (i % BLOCK) & 1) != 0;
+	}
+
+private:
+	// per plane the box corner that is furthest along the normal, if it is outside the box is outside
+	struct Plane
+	{
+		const float* x;
+		const float* y;
+		const float* z;
+		float a, b, c, d;
+	};
+
+	template <bool Scalar>
+	size_t cullBlocks(const Frustum* frusta, int frustumCount, std::vector<uint8_t>& visible) const
+	{
+		size_t blocks = (count + BLOCK - 1) / BLOCK;
+		visible.assign(blocks, 0);
+		if (count == 0 || frustumCount == 0)
+			return 0;
+
+		std::vector<Plane> planes(frustumCount * 6);
+		for (int f = 0; f < frustumCount; f++)
+			for (int p = 0; p < 6; p++)
+			{
+				const glm::vec4& n = frusta[f].planes[p];
+				Plane& plane = planes[f * 6 + p];
+				plane.x = &bounds[n.x >= 0.0f ? 3 : 0][0];
+				plane.y = &bounds[n.y >= 0.0f ? 4 : 1][0];
+				plane.z = &bounds[n.z >= 0.0f ? 5 : 2][0];
+				plane.a = n.x;
+				plane.b = n.y;
+				plane.c = n.z;
+				plane.d = n.w;
+			}
+
+		size_t visibleCount = 0;
+		for (size_t block = 0; block < blocks; block++)
+		{
+			size_t base = block * BLOCK;
+			unsigned int any = 0;
+			for (int f = 0; f < frustumCount && any != 0xFF; f++)
+			{
+				const Plane* frustum = &planes[f * 6];
+				any |= Scalar ? testScalar(frustum, base) : test(frustum, base);
+			}
+			// padding after the last box
+			if (base + BLOCK > count)
+				any &= (1u << (count - base)) - 1;
+			visible[block] = (uint8_t)any;
+			visibleCount += bitCount(any);
+		}
+		return visibleCount;
+	}
+
+	// bit mask of the 8 boxes from base on that are inside all six planes
+	static unsigned int testScalar(const Plane* planes, size_t base)
+	{
+		unsigned int inside = 0;
+		for (int i = 0; i < BLOCK; i++)
+		{
+			size_t b = base + i;
+			bool in = true;
+			for (int p = 0; p < 6 && in; p++)
+			{
+				const Plane& plane = planes[p];
+				in = plane.a * plane.x[b] + plane.b * plane.y[b] + plane.c * plane.z[b] + plane.d >= 0.0f;
+			}
+			inside |= (unsigned int)in << i;
+		}
+		return inside;
+	}
+
+#if defined(__AVX2__)
+	static unsigned int test(const Plane* planes, size_t base)
+	{
+		unsigned int inside = 0xFF;
+		for (int p = 0; p < 6 && inside != 0; p++)
+		{
+			const Plane& plane = planes[p];
+			__m256 d = _mm256_set1_ps(plane.d);
+			d = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.a), _mm256_loadu_ps(plane.x + base)), d);
+			d = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.b), _mm256_loadu_ps(plane.y + base)), d);
+			d = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.c), _mm256_loadu_ps(plane.z + base)), d);
+			inside &= (unsigned int)_mm256_movemask_ps(_mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_GE_OQ));
+		}
+		return inside;
+	}
+#elif defined(CULLING_SSE)
+	static unsigned int test(const Plane* planes, size_t base)
+	{
+		unsigned int inside = 0xFF;
+		for (int p = 0; p < 6 && inside != 0; p++)
+		{
+			const Plane& plane = planes[p];
+			__m128 a = _mm_set1_ps(plane.a), b = _mm_set1_ps(plane.b), c = _mm_set1_ps(plane.c), d = _mm_set1_ps(plane.d);
+			__m128 lo = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, _mm_loadu_ps(plane.x + base)), _mm_mul_ps(b, _mm_loadu_ps(plane.y + base))),
+				_mm_add_ps(_mm_mul_ps(c, _mm_loadu_ps(plane.z + base)), d));
+			__m128 hi = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, _mm_loadu_ps(plane.x + base + 4)), _mm_mul_ps(b, _mm_loadu_ps(plane.y + base + 4))),
+				_mm_add_ps(_mm_mul_ps(c, _mm_loadu_ps(plane.z + base + 4)), d));
+			__m128 zero = _mm_setzero_ps();
+			inside &= (unsigned int)(_mm_movemask_ps(_mm_cmpge_ps(lo, zero)) | _mm_movemask_ps(_mm_cmpge_ps(hi, zero)) << 4);
+		}
+		return inside;
+	}
+#else
+	static unsigned int test(const Plane* planes, size_t base)
+	{
+		return testScalar(planes, base);
+	}
+#endif
+
+	static unsigned int bitCount(unsigned int bits)
+	{
+		unsigned int n = 0;
+		for (; bits != 0; bits &= bits - 1)
+			n++;
+		return n;
+	}
+
+	// min x, y, z and max x, y, z, padded to a multiple of BLOCK
+	std::vector<float> bounds[6];
+	size_t count = 0;
+};
+
+#endif
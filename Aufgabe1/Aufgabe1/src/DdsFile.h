@@ -0,0 +1,177 @@
+#ifndef DDSFILE_H
+#define DDSFILE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Block compressed textures with their mip chain in DDS files: BC1 (DXT1, color), BC3 (DXT5, color with alpha)
+// and BC5 (ATI2, two channels for normal maps). Written by the TextureTool project, read by the TextureLoader.
+// Every 4x4 block takes 8 (BC1) or 16 bytes, mip levels are stored one after the other, the largest first.
+
+enum BlockFormat
+{
+	FORMAT_BC1,
+	FORMAT_BC3,
+	FORMAT_BC5
+};
+
+struct CompressedImage
+{
+	BlockFormat format = FORMAT_BC1;
+	int width = 0;
+	int height = 0;
+	int levels = 0;
+	// all levels one after the other
+	std::vector<uint8_t> data;
+
+	static int blockBytes(BlockFormat format)
+	{
+		return format == FORMAT_BC1 ? 8 : 16;
+	}
+
+	// size of a level of the given size in bytes, partial blocks at the border count as full blocks
+	static size_t levelBytes(BlockFormat format, int width, int height)
+	{
+		return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+	}
+
+	int levelWidth(int level) const
+	{
+		return std::max(1, width >> level);
+	}
+
+	int levelHeight(int level) const
+	{
+		return std::max(1, height >> level);
+	}
+
+	size_t levelOffset(int level) const
+	{
+		size_t offset = 0;
+		for (int l = 0; l < level; l++)
+			offset += levelBytes(format, levelWidth(l), levelHeight(l));
+		return offset;
+	}
+
+	size_t levelSize(int level) const
+	{
+		return levelBytes(format, levelWidth(level), levelHeight(level));
+	}
+};
+
+namespace dds
+{
+	const uint32_t MAGIC = 0x20534444; // "DDS "
+	const uint32_t HEADER_CAPS = 0x1, HEADER_HEIGHT = 0x2, HEADER_WIDTH = 0x4, HEADER_PIXELFORMAT = 0x1000,
+		HEADER_MIPMAPCOUNT = 0x20000, HEADER_LINEARSIZE = 0x80000;
+	const uint32_t PIXELFORMAT_FOURCC = 0x4;
+	const uint32_t CAPS_COMPLEX = 0x8, CAPS_TEXTURE = 0x1000, CAPS_MIPMAP = 0x400000;
+	// larger images are rejected before anything is allocated for them
+	const uint32_t MAX_SIZE = 16384;
+
+	inline uint32_t fourCC(const char* code)
+	{
+		return (uint32_t)code[0] | ((uint32_t)code[1] << 8) | ((uint32_t)code[2] << 16) | ((uint32_t)code[3] << 24);
+	}
+
+	struct PixelFormat
+	{
+		uint32_t size, flags, fourCC, rgbBitCount, rMask, gMask, bMask, aMask;
+	};
+
+	struct Header
+	{
+		uint32_t size, flags, height, width, pitchOrLinearSize, depth, mipMapCount, reserved1[11];
+		PixelFormat pixelFormat;
+		uint32_t caps, caps2, caps3, caps4, reserved2;
+	};
+}
+
+inline bool writeDds(const std::string& path, const CompressedImage& image)
+{
+	dds::Header header;
+	std::memset(&header, 0, sizeof(header));
+	header.size = sizeof(dds::Header);
+	header.flags = dds::HEADER_CAPS | dds::HEADER_HEIGHT | dds::HEADER_WIDTH | dds::HEADER_PIXELFORMAT | dds::HEADER_MIPMAPCOUNT | dds::HEADER_LINEARSIZE;
+	header.height = image.height;
+	header.width = image.width;
+	header.pitchOrLinearSize = (uint32_t)image.levelSize(0);
+	header.mipMapCount = image.levels;
+	header.pixelFormat.size = sizeof(dds::PixelFormat);
+	header.pixelFormat.flags = dds::PIXELFORMAT_FOURCC;
+	header.pixelFormat.fourCC = dds::fourCC(image.format == FORMAT_BC1 ? "DXT1" : image.format == FORMAT_BC3 ? "DXT5" : "ATI2");
+	header.caps = dds::CAPS_TEXTURE | (image.levels > 1 ? dds::CAPS_COMPLEX | dds::CAPS_MIPMAP : 0);
+
+	FILE* file = std::fopen(path.c_str(), "wb");
+	if (file == nullptr)
+		return false;
+	bool ok = std::fwrite(&dds::MAGIC, 4, 1, file) == 1 && std::fwrite(&header, sizeof(header), 1, file) == 1
+		&& std::fwrite(image.data.data(), 1, image.data.size(), file) == image.data.size();
+	return std::fclose(file) == 0 && ok;
+}
+
+namespace dds
+{
+	// format, size and level count of a BC1, BC3 or BC5 file up to MAX_SIZE, the file is left at the first level.
+	// A mip count beyond the 1x1 level is cut off there.
+	inline bool readHeader(FILE* file, CompressedImage& image)
+	{
+		uint32_t magic = 0;
+		Header header;
+		if (std::fread(&magic, 4, 1, file) != 1 || magic != MAGIC || std::fread(&header, sizeof(header), 1, file) != 1
+			|| header.size != sizeof(Header) || !(header.pixelFormat.flags & PIXELFORMAT_FOURCC))
+			return false;
+		uint32_t code = header.pixelFormat.fourCC;
+		if (code == fourCC("DXT1"))
+			image.format = FORMAT_BC1;
+		else if (code == fourCC("DXT5"))
+			image.format = FORMAT_BC3;
+		else if (code == fourCC("ATI2") || code == fourCC("BC5U"))
+			image.format = FORMAT_BC5;
+		else
+			return false;
+		if (header.width == 0 || header.height == 0 || header.width > MAX_SIZE || header.height > MAX_SIZE)
+			return false;
+		image.width = (int)header.width;
+		image.height = (int)header.height;
+		int maxLevels = 1;
+		while ((std::max(image.width, image.height) >> maxLevels) > 0)
+			maxLevels++;
+		uint32_t levels = (header.flags & HEADER_MIPMAPCOUNT) ? header.mipMapCount : 1u;
+		image.levels = (int)std::min((uint32_t)maxLevels, std::max(1u, levels));
+		return true;
+	}
+}
+
+// only the header of the file (format, size, levels), image.data stays empty
+inline bool readDdsInfo(const std::string& path, CompressedImage& image)
+{
+	FILE* file = std::fopen(path.c_str(), "rb");
+	if (file == nullptr)
+		return false;
+	bool ok = dds::readHeader(file, image);
+	std::fclose(file);
+	return ok;
+}
+
+// reads BC1, BC3 and BC5 files, false for anything else (see dds::readHeader)
+inline bool readDds(const std::string& path, CompressedImage& image)
+{
+	FILE* file = std::fopen(path.c_str(), "rb");
+	if (file == nullptr)
+		return false;
+	bool ok = dds::readHeader(file, image);
+	if (ok)
+	{
+		image.data.resize(image.levelOffset(image.levels));
+		ok = std::fread(image.data.data(), 1, image.data.size(), file) == image.data.size();
+	}
+	std::fclose(file);
+	return ok;
+}
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef FRAMEREPORT_H
+#define FRAMEREPORT_H
+
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Frame times and draw counts of a headless run, written as JSON at the end.
+// CPU time is measured by the caller, GPU times are the scopes of the GpuProfiler (which has to keep its
+// frames, see GpuProfiler::keepFrames), the GPU frame time is the sum of all scopes.
+class FrameReport
+{
+public:
+	void start()
+	{
+		running = true;
+	}
+
+	bool active() const
+	{
+		return running;
+	}
+
+	// extra values for the report (resolution, object count, ...)
+	void describe(const std::string& key, double value)
+	{
+		info.push_back(std::make_pair(key, value));
+	}
+
+	// at the end of every frame
+	void endFrame(double cpuSeconds, unsigned long long shadowDraws, unsigned long long lightingDraws,
+		unsigned long long shadowTriangles, unsigned long long lightingTriangles)
+	{
+		if (!running)
+			return;
+		cpuMs.push_back(cpuSeconds * 1000.0);
+		draws[0] += shadowDraws;
+		draws[1] += lightingDraws;
+		triangles[0] += shadowTriangles;
+		triangles[1] += lightingTriangles;
+		frame++;
+	}
+
+	// writes the report, the profiler has to be flushed before
+	void finish(std::ostream& out, const GpuProfiler& gpu)
+	{
+		if (!running)
+			return;
+		running = false;
+
+		std::vector<double> gpuMs;
+		for (int s = 0; s < gpu.scopeCount(); s++)
+		{
+			const std::vector<double>& times = gpu.frames(s);
+			gpuMs.resize(std::max(gpuMs.size(), times.size()), 0.0);
+			for (size_t f = 0; f < times.size(); f++)
+				gpuMs[f] += times[f];
+		}
+
+		double frames = std::max(frame, 1);
+		out << "{" << std::endl;
+		for (const auto& value : info)
+			out << "  \"" << value.first << "\": " << value.second << "," << std::endl;
+		out << "  \"frames\": " << frame << "," << std::endl;
+		writeTimes(out, "cpu_frame_ms", cpuMs);
+		writeTimes(out, "gpu_frame_ms", gpuMs);
+		for (int s = 0; s < gpu.scopeCount(); s++)
+			writeTimes(out, ("gpu_" + gpu.name(s) + "_ms").c_str(), gpu.frames(s));
+		out << "  \"draw_calls\": { \"shadow\": " << draws[0] / frames << ", \"lighting\": " << draws[1] / frames << " }," << std::endl;
+		out << "  \"triangles\": { \"shadow\": " << triangles[0] / frames << ", \"lighting\": " << triangles[1] / frames << " }" << std::endl;
+		out << "}" << std::endl;
+	}
+
+private:
+	// nearest rank percentile of sorted values
+	static double percentile(const std::vector<double>& sorted, double p)
+	{
+		if (sorted.empty())
+			return 0.0;
+		size_t rank = (size_t)std::ceil(p / 100.0 * sorted.size());
+		return sorted[std::min(sorted.size(), std::max(rank, (size_t)1)) - 1];
+	}
+
+	static void writeTimes(std::ostream& out, const char* name, std::vector<double> values)
+	{
+		std::sort(values.begin(), values.end());
+		double sum = 0.0;
+		for (double v : values)
+			sum += v;
+		out << "  \"" << name << "\": { \"mean\": " << (values.empty() ? 0.0 : sum / values.size())
+			<< ", \"p50\": " << percentile(values, 50.0) << ", \"p95\": " << percentile(values, 95.0)
+			<< ", \"p99\": " << percentile(values, 99.0) << ", \"max\": " << (values.empty() ? 0.0 : values.back()) << " }," << std::endl;
+	}
+
+	bool running = false;
+	int frame = 0;
+	std::vector<std::pair<std::string, double>> info;
+	std::vector<double> cpuMs;
+	unsigned long long draws[2] = {};
+	unsigned long long triangles[2] = {};
+};
+
+#endif
@@ -0,0 +1,299 @@
+#ifndef GLSTATE_H
+#define GLSTATE_H
+
+#include <glad/glad.h>
+
+// Thin cache in front of the GL state that is changed during rendering: program, vertex array,
+// textures per unit, framebuffers, viewport, capabilities (cull face, depth test, ...), cull mode
+// and depth func/mask. A call that would not change the current state is dropped.
+// Everything that changes this state has to go through the cache, otherwise call reset() afterwards
+// so the next call of every kind is issued again. When a GL object is deleted its name can be reused
+// by the next glGen*, so deleting objects that might be bound has to be reported with forget*().
+// issued()/elided() count the calls of the current frame, endFrame() adds them to the totals.
+class GLState
+{
+public:
+	static const int MAX_UNITS = 16;
+
+	GLState()
+	{
+		reset();
+	}
+
+	// forget everything, the next call of each kind is issued
+	void reset()
+	{
+		program = UNKNOWN;
+		vertexArray = UNKNOWN;
+		activeUnit = UNKNOWN;
+		for (int u = 0; u < MAX_UNITS; u++)
+			for (int t = 0; t < TARGET_COUNT; t++)
+				textures[u][t] = UNKNOWN;
+		readFramebuffer = drawFramebuffer = UNKNOWN;
+		viewportX = viewportY = viewportWidth = viewportHeight = -1;
+		for (int c = 0; c < CAPABILITY_COUNT; c++)
+			capabilities[c] = -1;
+		cullMode = UNKNOWN;
+		depthFunction = UNKNOWN;
+		depthWrite = -1;
+	}
+
+	void useProgram(GLuint id)
+	{
+		if (changed(program, id))
+			glUseProgram(id);
+	}
+
+	void bindVertexArray(GLuint id)
+	{
+		if (changed(vertexArray, id))
+			glBindVertexArray(id);
+	}
+
+	// unit is the index (0, 1, ...), not GL_TEXTURE0 + index
+	void activeTexture(GLuint unit)
+	{
+		if (changed(activeUnit, unit))
+			glActiveTexture(GL_TEXTURE0 + unit);
+	}
+
+	// bind to the active unit
+	void bindTexture(GLenum target, GLuint id)
+	{
+		int t = targetIndex(target);
+		if (t < 0 || activeUnit >= (GLuint)MAX_UNITS)
+		{
+			issue();
+			glBindTexture(target, id);
+			return;
+		}
+		if (changed(textures[activeUnit][t], id))
+			glBindTexture(target, id);
+	}
+
+	void bindTexture(GLuint unit, GLenum target, GLuint id)
+	{
+		int t = targetIndex(target);
+		if (t >= 0 && unit < (GLuint)MAX_UNITS && textures[unit][t] == id)
+		{
+			elide();
+			return;
+		}
+		activeTexture(unit);
+		bindTexture(target, id);
+	}
+
+	// GL_FRAMEBUFFER sets both read and draw binding
+	void bindFramebuffer(GLenum target, GLuint id)
+	{
+		if (target == GL_FRAMEBUFFER)
+		{
+			if (readFramebuffer == id && drawFramebuffer == id)
+			{
+				elide();
+				return;
+			}
+			issue();
+			readFramebuffer = drawFramebuffer = id;
+			glBindFramebuffer(target, id);
+		}
+		else if (changed(target == GL_READ_FRAMEBUFFER ? readFramebuffer : drawFramebuffer, id))
+		{
+			glBindFramebuffer(target, id);
+		}
+	}
+
+	void viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+	{
+		if (viewportX == x && viewportY == y && viewportWidth == width && viewportHeight == height)
+		{
+			elide();
+			return;
+		}
+		issue();
+		viewportX = x;
+		viewportY = y;
+		viewportWidth = width;
+		viewportHeight = height;
+		glViewport(x, y, width, height);
+	}
+
+	// glEnable/glDisable
+	void setCapability(GLenum capability, bool enabled)
+	{
+		int c = capabilityIndex(capability);
+		if (c >= 0 && capabilities[c] == (int)enabled)
+		{
+			elide();
+			return;
+		}
+		issue();
+		if (c >= 0)
+			capabilities[c] = enabled;
+		if (enabled)
+			glEnable(capability);
+		else
+			glDisable(capability);
+	}
+
+	void cullFace(GLenum mode)
+	{
+		if (changed(cullMode, mode))
+			glCullFace(mode);
+	}
+
+	void depthFunc(GLenum function)
+	{
+		if (changed(depthFunction, function))
+			glDepthFunc(function);
+	}
+
+	void depthMask(bool write)
+	{
+		if (depthWrite == (int)write)
+		{
+			elide();
+			return;
+		}
+		issue();
+		depthWrite = write;
+		glDepthMask(write ? GL_TRUE : GL_FALSE);
+	}
+
+	// deleted objects, their names may come back from glGen*
+	void forgetProgram(GLuint id)
+	{
+		if (program == id)
+			program = UNKNOWN;
+	}
+
+	void forgetVertexArray(GLuint id)
+	{
+		if (vertexArray == id)
+			vertexArray = UNKNOWN;
+	}
+
+	void forgetTexture(GLuint id)
+	{
+		for (int u = 0; u < MAX_UNITS; u++)
+			for (int t = 0; t < TARGET_COUNT; t++)
+				if (textures[u][t] == id)
+					textures[u][t] = UNKNOWN;
+	}
+
+	void forgetFramebuffer(GLuint id)
+	{
+		if (readFramebuffer == id)
+			readFramebuffer = UNKNOWN;
+		if (drawFramebuffer == id)
+			drawFramebuffer = UNKNOWN;
+	}
+
+	// calls passed to GL / dropped in the current frame
+	unsigned long long issued() const
+	{
+		return frameIssued;
+	}
+
+	unsigned long long elided() const
+	{
+		return frameElided;
+	}
+
+	// over all finished frames
+	unsigned long long totalIssued() const
+	{
+		return sumIssued;
+	}
+
+	unsigned long long totalElided() const
+	{
+		return sumElided;
+	}
+
+	unsigned long long frames() const
+	{
+		return frameCount;
+	}
+
+	void endFrame()
+	{
+		sumIssued += frameIssued;
+		sumElided += frameElided;
+		frameIssued = frameElided = 0;
+		frameCount++;
+	}
+
+private:
+	static const GLuint UNKNOWN = 0xFFFFFFFFu;
+	static const int TARGET_COUNT = 4;
+	static const int CAPABILITY_COUNT = 5;
+
+	static int targetIndex(GLenum target)
+	{
+		switch (target)
+		{
+		case GL_TEXTURE_2D: return 0;
+		case GL_TEXTURE_2D_ARRAY: return 1;
+		case GL_TEXTURE_CUBE_MAP: return 2;
+		case GL_TEXTURE_2D_MULTISAMPLE: return 3;
+		default: return -1;
+		}
+	}
+
+	static int capabilityIndex(GLenum capability)
+	{
+		switch (capability)
+		{
+		case GL_DEPTH_TEST: return 0;
+		case GL_CULL_FACE: return 1;
+		case GL_MULTISAMPLE: return 2;
+		case GL_BLEND: return 3;
+		case GL_SCISSOR_TEST: return 4;
+		default: return -1;
+		}
+	}
+
+	// stores value, true if the call has to be issued
+	bool changed(GLuint& current, GLuint value)
+	{
+		if (current == value)
+		{
+			elide();
+			return false;
+		}
+		issue();
+		current = value;
+		return true;
+	}
+
+	void issue()
+	{
+		frameIssued++;
+	}
+
+	void elide()
+	{
+		frameElided++;
+	}
+
+	GLuint program, vertexArray, activeUnit;
+	GLuint textures[MAX_UNITS][TARGET_COUNT];
+	GLuint readFramebuffer, drawFramebuffer;
+	GLint viewportX, viewportY;
+	GLsizei viewportWidth, viewportHeight;
+	int capabilities[CAPABILITY_COUNT];
+	GLuint cullMode, depthFunction;
+	int depthWrite;
+	unsigned long long frameIssued = 0, frameElided = 0;
+	unsigned long long sumIssued = 0, sumElided = 0, frameCount = 0;
+};
+
+// the state cache of the (single) GL context
+inline GLState& glState()
+{
+	static GLState state;
+	return state;
+}
+
+#endif
@@ -0,0 +1,221 @@
+#ifndef GPUPROFILER_H
+#define GPUPROFILER_H
+
+#include <glad/glad.h>
+
+#include "GLState.h"
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// GPU time of named scopes (shadow pass, lit pass, ...) from a GL_TIMESTAMP query at the begin and end of
+// each scope (timestamps can be nested and don't collide with GL_TIME_ELAPSED queries of the shadow benchmark).
+// The queries live in a ring of FRAME_RING frames, a frame is read back when its slot is reused, by then
+// the GPU has finished it and the read doesn't wait. Results are averaged over the last HISTORY frames,
+// a scope that wasn't used in a frame counts as 0 ms. Optionally every frame is written to a CSV file or kept
+// for the headless report (see FrameReport.h).
+class GpuProfiler
+{
+public:
+	static const int MAX_SCOPES = 8;
+	static const int FRAME_RING = 4;
+	static const int HISTORY = 64;
+
+	GpuProfiler()
+	{
+		glGenQueries(FRAME_RING * MAX_SCOPES * 2, &queries[0][0][0]);
+	}
+
+	// frees the queries and closes the CSV file, has to be called while the context is still alive
+	void release()
+	{
+		flush();
+		glDeleteQueries(FRAME_RING * MAX_SCOPES * 2, &queries[0][0][0]);
+		csv.close();
+	}
+
+	// register a scope at setup, returns its id (-1 if there are too many)
+	int addScope(const std::string& name)
+	{
+		if ((int)scopes.size() == MAX_SCOPES)
+			return -1;
+		scopes.push_back(Scope());
+		scopes.back().name = name;
+		return (int)scopes.size() - 1;
+	}
+
+	// one line per frame with the time of every scope in ms, call after all scopes are added
+	bool openCsv(const char* path)
+	{
+		csv.open(path);
+		if (!csv)
+			return false;
+		csv << "frame";
+		for (const Scope& scope : scopes)
+			csv << "," << scope.name << "_ms";
+		csv << std::endl;
+		return true;
+	}
+
+	// keep the time of every read back frame, see frames()
+	void keepFrames()
+	{
+		keepAll = true;
+	}
+
+	void beginFrame()
+	{
+		current = frame % FRAME_RING;
+		if (pending[current])
+			resolve(current);
+		for (int s = 0; s < MAX_SCOPES; s++)
+			used[current][s] = false;
+		pending[current] = true;
+		frameNumber[current] = frame;
+	}
+
+	void begin(int scope)
+	{
+		glQueryCounter(queries[current][scope][0], GL_TIMESTAMP);
+		used[current][scope] = true;
+	}
+
+	void end(int scope)
+	{
+		glQueryCounter(queries[current][scope][1], GL_TIMESTAMP);
+	}
+
+	void endFrame()
+	{
+		frame++;
+	}
+
+	// reads all frames still in the ring (at exit)
+	void flush()
+	{
+		for (int f = frame - FRAME_RING; f < frame; f++)
+			if (f >= 0 && pending[f % FRAME_RING])
+				resolve(f % FRAME_RING);
+	}
+
+	int scopeCount() const
+	{
+		return (int)scopes.size();
+	}
+
+	const std::string& name(int scope) const
+	{
+		return scopes[scope].name;
+	}
+
+	// average over the last HISTORY read back frames in ms
+	double average(int scope) const
+	{
+		const Scope& s = scopes[scope];
+		return s.count > 0 ? s.sum / s.count : 0.0;
+	}
+
+	// every read back frame in ms, oldest first (only filled after keepFrames())
+	const std::vector<double>& frames(int scope) const
+	{
+		return scopes[scope].frames;
+	}
+
+	// time of the newest read back frame in ms
+	double last(int scope) const
+	{
+		const Scope& s = scopes[scope];
+		return s.count > 0 ? s.history[(s.next + HISTORY - 1) % HISTORY] : 0.0;
+	}
+
+	// one bar per scope in the top left corner, drawn with scissored clears so it needs no shader.
+	// Half the width is 16.7 ms (60 fps), marked with a white line. Changes the clear color.
+	void drawOverlay(int width, int height)
+	{
+		static const float colors[MAX_SCOPES][3] = {
+			{ 0.9f, 0.3f, 0.2f }, { 0.2f, 0.8f, 0.3f }, { 0.3f, 0.5f, 1.0f }, { 0.9f, 0.8f, 0.2f },
+			{ 0.8f, 0.3f, 0.9f }, { 0.2f, 0.9f, 0.9f }, { 1.0f, 0.6f, 0.2f }, { 0.7f, 0.7f, 0.7f }
+		};
+		const int barHeight = 8, gap = 4, margin = 10;
+		float pixelsPerMs = width * 0.5f / 16.667f;
+
+		glState().setCapability(GL_SCISSOR_TEST, true);
+		int top = height - margin;
+		for (int s = 0; s < (int)scopes.size(); s++)
+		{
+			int y = top - (s + 1) * (barHeight + gap);
+			int length = (int)(average(s) * pixelsPerMs);
+			glScissor(margin, y, width - 2 * margin, barHeight);
+			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT);
+			if (length > 0)
+			{
+				glScissor(margin, y, std::min(length, width - 2 * margin), barHeight);
+				glClearColor(colors[s][0], colors[s][1], colors[s][2], 1.0f);
+				glClear(GL_COLOR_BUFFER_BIT);
+			}
+		}
+		int bottom = top - (int)scopes.size() * (barHeight + gap);
+		glScissor(margin + (int)(16.667f * pixelsPerMs), bottom, 1, top - bottom);
+		glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+		glState().setCapability(GL_SCISSOR_TEST, false);
+	}
+
+private:
+	struct Scope
+	{
+		std::string name;
+		double history[HISTORY];
+		int next = 0;
+		int count = 0;
+		double sum = 0.0;
+		std::vector<double> frames;
+	};
+
+	void resolve(int slot)
+	{
+		if (csv.is_open())
+			csv << frameNumber[slot];
+		for (int s = 0; s < (int)scopes.size(); s++)
+		{
+			double ms = 0.0;
+			if (used[slot][s])
+			{
+				GLuint64 begin = 0, end = 0;
+				glGetQueryObjectui64v(queries[slot][s][0], GL_QUERY_RESULT, &begin);
+				glGetQueryObjectui64v(queries[slot][s][1], GL_QUERY_RESULT, &end);
+				ms = (end - begin) / 1000000.0;
+			}
+			Scope& scope = scopes[s];
+			if (scope.count == HISTORY)
+				scope.sum -= scope.history[scope.next];
+			else
+				scope.count++;
+			scope.history[scope.next] = ms;
+			scope.sum += ms;
+			scope.next = (scope.next + 1) % HISTORY;
+			if (keepAll)
+				scope.frames.push_back(ms);
+			if (csv.is_open())
+				csv << "," << ms;
+		}
+		if (csv.is_open())
+			csv << "\n";
+		pending[slot] = false;
+	}
+
+	GLuint queries[FRAME_RING][MAX_SCOPES][2];
+	bool used[FRAME_RING][MAX_SCOPES] = {};
+	bool pending[FRAME_RING] = {};
+	int frameNumber[FRAME_RING] = {};
+	int frame = 0;
+	int current = 0;
+	bool keepAll = false;
+	std::vector<Scope> scopes;
+	std::ofstream csv;
+};
+
+#endif
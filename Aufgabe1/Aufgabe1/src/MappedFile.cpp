@@ -0,0 +1,94 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+bool MappedFile::open(const char* path)
+{
+	close();
+	HANDLE f = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, NULL);
+	if (f == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(f, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(f);
+		return false;
+	}
+	HANDLE m = CreateFileMappingA(f, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (m == NULL)
+	{
+		CloseHandle(f);
+		return false;
+	}
+	void* v = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+	if (v == NULL)
+	{
+		CloseHandle(m);
+		CloseHandle(f);
+		return false;
+	}
+	file = f;
+	mapping = m;
+	view = v;
+	length = (size_t)fileSize.QuadPart;
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (view)
+		UnmapViewOfFile(view);
+	if (mapping)
+		CloseHandle((HANDLE)mapping);
+	if (file)
+		CloseHandle((HANDLE)file);
+	view = nullptr;
+	mapping = nullptr;
+	file = nullptr;
+	length = 0;
+}
+
+#else
+
+bool MappedFile::open(const char* path)
+{
+	close();
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0)
+	{
+		::close(fd);
+		return false;
+	}
+	void* v = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	// the mapping keeps the file alive, the descriptor is not needed anymore
+	::close(fd);
+	if (v == MAP_FAILED)
+		return false;
+	view = v;
+	length = (size_t)info.st_size;
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (view)
+		munmap(view, length);
+	view = nullptr;
+	length = 0;
+}
+
+#endif
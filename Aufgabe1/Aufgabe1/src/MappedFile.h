@@ -0,0 +1,31 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+
+// read-only memory mapping of a whole file, the data stays valid until close() or destruction
+class MappedFile
+{
+public:
+	MappedFile() {}
+	~MappedFile() { close(); }
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// maps the file, returns false if it can't be opened or is empty
+	bool open(const char* path);
+	void close();
+
+	const unsigned char* data() const { return (const unsigned char*)view; }
+	size_t size() const { return length; }
+	bool isOpen() const { return view != nullptr; }
+
+private:
+	void* view = nullptr;
+	size_t length = 0;
+	// platform handles (file descriptor / file and mapping HANDLE)
+	void* file = nullptr;
+	void* mapping = nullptr;
+};
+
+#endif
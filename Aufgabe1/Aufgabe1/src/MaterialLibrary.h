@@ -0,0 +1,128 @@
+#ifndef MATERIALLIBRARY_H
+#define MATERIALLIBRARY_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "GLState.h"
+#include "RenderQueue.h"
+#include "TextureLoader.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Materials packed into two texture arrays: layer i of the diffuse array and of the normal map array belong to
+// material i. The layer goes to shader.fs as a per instance attribute (see RenderQueue), so objects with different
+// materials of one library are still drawn with one instanced call per mesh. All images of a library must have
+// the same size, images of another size need a library of their own. An array is block compressed (BC1 diffuse,
+// BC5 normal maps, see TextureTool) if every one of its images has a DDS file of the same format next to it,
+// RGB8 otherwise.
+class MaterialLibrary
+{
+public:
+	explicit MaterialLibrary(int size = 1024)
+		: size(size)
+	{
+	}
+
+	// returns the layer of the material, valid after build()
+	int add(const std::string& diffusePath, const std::string& normalPath)
+	{
+		diffusePaths.push_back(diffusePath);
+		normalPaths.push_back(normalPath);
+		return (int)diffusePaths.size() - 1;
+	}
+
+	// creates the arrays with a layer per material, showing the placeholder colors (grey diffuse, flat normal)
+	// until the loader has uploaded the images
+	void build(TextureLoader& loader)
+	{
+		int layers = (int)diffusePaths.size();
+		glm::vec3 grey(0.5f), flat(0.5f, 0.5f, 1.0f);
+		int32_t diffuseFormat = arrayFormat(loader, diffusePaths);
+		int32_t normalFormat = arrayFormat(loader, normalPaths);
+		diffuseArray = createArray(layers, diffuseFormat, grey);
+		normalArray = createArray(layers, normalFormat, flat);
+		for (int layer = 0; layer < layers; layer++)
+		{
+			loader.loadLayer(diffuseArray, layer, size, size, diffusePaths[layer], grey, MIP_COLOR, diffuseFormat);
+			loader.loadLayer(normalArray, layer, size, size, normalPaths[layer], flat, MIP_NORMAL, normalFormat);
+		}
+	}
+
+	Material material(int layer) const
+	{
+		return { { diffuseArray, normalArray }, layer };
+	}
+
+	void release()
+	{
+		for (GLuint* array : { &diffuseArray, &normalArray })
+		{
+			glState().forgetTexture(*array);
+			glDeleteTextures(1, array);
+			*array = 0;
+		}
+	}
+
+private:
+	int levelCount() const
+	{
+		int levels = 1;
+		while ((size >> levels) > 0)
+			levels++;
+		return levels;
+	}
+
+	// the block format of the DDS files of the images if all of them have one with the same format, the size of the
+	// library and the full mip chain, texcache::UNCOMPRESSED otherwise
+	int32_t arrayFormat(const TextureLoader& loader, const std::vector<std::string>& paths) const
+	{
+		int32_t format = texcache::UNCOMPRESSED;
+		for (size_t i = 0; i < paths.size(); i++)
+		{
+			CompressedImage info;
+			if (!readDdsInfo(TextureLoader::ddsPath(paths[i]), info) || !loader.supports(info.format) || (i > 0 && info.format != format)
+				|| info.width != size || info.height != size || info.levels != levelCount())
+				return texcache::UNCOMPRESSED;
+			format = info.format;
+		}
+		return format;
+	}
+
+	// the full mip chain without data, repeating (no alpha in the library). Only the 1x1 level of every layer gets
+	// the placeholder color and is the base level until the loader has filled all layers (see loadLayer).
+	GLuint createArray(int layers, int32_t format, const glm::vec3& placeholder)
+	{
+		int levels = levelCount();
+		GLuint array;
+		glGenTextures(1, &array);
+		glState().bindTexture(GL_TEXTURE_2D_ARRAY, array);
+		for (int level = 0; level < levels; level++)
+		{
+			int s = std::max(1, size >> level);
+			if (format == texcache::UNCOMPRESSED)
+				glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGB8, s, s, layers, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+			else
+				glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, TextureLoader::compressedFormat((BlockFormat)format), s, s, layers, 0,
+					(GLsizei)(CompressedImage::levelBytes((BlockFormat)format, s, s) * layers), nullptr);
+		}
+		for (int layer = 0; layer < layers; layer++)
+			TextureLoader::fillLevel(layer, levels - 1, 1, 1, format, placeholder);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, levels - 1);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		return array;
+	}
+
+	int size;
+	std::vector<std::string> diffusePaths, normalPaths;
+	GLuint diffuseArray = 0;
+	GLuint normalArray = 0;
+};
+
+#endif
@@ -0,0 +1,312 @@
+#ifndef MIPGENERATOR_H
+#define MIPGENERATOR_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIPGENERATOR_SSE
+#endif
+
+// Mip chains built on the CPU instead of glGenerateMipmap's box filter. Every level is resampled from the one
+// above with a separable windowed sinc (Kaiser or Lanczos 3), one RGBA texel per SSE register, rows split
+// between threads. Color is filtered in linear space (the bytes are sRGB) and encoded again, normal maps are
+// renormalized per texel after filtering.
+
+enum MipMode
+{
+	MIP_COLOR,
+	MIP_LINEAR,
+	MIP_NORMAL
+};
+
+enum MipFilter
+{
+	FILTER_KAISER,
+	FILTER_LANCZOS
+};
+
+// all levels of an 8 bit image with 1-4 channels, tightly packed one after the other, the largest first
+struct MipChain
+{
+	int width = 0;
+	int height = 0;
+	int components = 0;
+	int levels = 0;
+	std::vector<uint8_t> data;
+
+	int levelWidth(int level) const
+	{
+		return std::max(1, width >> level);
+	}
+
+	int levelHeight(int level) const
+	{
+		return std::max(1, height >> level);
+	}
+
+	size_t levelSize(int level) const
+	{
+		return (size_t)levelWidth(level) * levelHeight(level) * components;
+	}
+
+	size_t levelOffset(int level) const
+	{
+		size_t offset = 0;
+		for (int l = 0; l < level; l++)
+			offset += levelSize(l);
+		return offset;
+	}
+};
+
+namespace mips
+{
+	const float PI = 3.14159265f;
+	// half width of the kernels in destination texels
+	const float SUPPORT = 3.0f;
+	const float KAISER_ALPHA = 4.0f;
+
+	inline float sinc(float x)
+	{
+		return std::fabs(x) < 1e-5f ? 1.0f : std::sin(PI * x) / (PI * x);
+	}
+
+	// zeroth order modified Bessel function of the first kind
+	inline float bessel0(float x)
+	{
+		float sum = 1.0f, term = 1.0f;
+		for (int k = 1; k < 20; k++)
+		{
+			term *= (x / (2.0f * k)) * (x / (2.0f * k));
+			sum += term;
+		}
+		return sum;
+	}
+
+	inline float kernel(MipFilter filter, float x)
+	{
+		if (std::fabs(x) >= SUPPORT)
+			return 0.0f;
+		if (filter == FILTER_LANCZOS)
+			return sinc(x) * sinc(x / SUPPORT);
+		float r = x / SUPPORT;
+		return sinc(x) * bessel0(KAISER_ALPHA * std::sqrt(1.0f - r * r)) / bessel0(KAISER_ALPHA);
+	}
+
+	// source texels and weights of one destination texel
+	struct Taps
+	{
+		std::vector<int> index;
+		std::vector<float> weight;
+	};
+
+	// taps for resampling size src to dst (wrapping around or clamping at the border), normalized to sum 1
+	inline std::vector<Taps> makeTaps(int src, int dst, MipFilter filter, bool wrap)
+	{
+		std::vector<Taps> taps(dst);
+		float scale = (float)src / dst;
+		for (int d = 0; d < dst; d++)
+		{
+			float center = (d + 0.5f) * scale;
+			int first = (int)std::floor(center - SUPPORT * scale), last = (int)std::ceil(center + SUPPORT * scale);
+			float sum = 0.0f;
+			for (int s = first; s <= last; s++)
+			{
+				float w = kernel(filter, (s + 0.5f - center) / scale);
+				if (w == 0.0f)
+					continue;
+				int i = wrap ? ((s % src) + src) % src : std::min(src - 1, std::max(0, s));
+				taps[d].index.push_back(i);
+				taps[d].weight.push_back(w);
+				sum += w;
+			}
+			for (float& w : taps[d].weight)
+				w /= sum;
+		}
+		return taps;
+	}
+
+	// out = sum of weight * texel for RGBA float texels
+	inline void accumulate(const float* const* texels, const float* weights, size_t count, float* out)
+	{
+#ifdef MIPGENERATOR_SSE
+		__m128 sum = _mm_setzero_ps();
+		for (size_t i = 0; i < count; i++)
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[i]), _mm_loadu_ps(texels[i])));
+		_mm_storeu_ps(out, sum);
+#else
+		float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		for (size_t i = 0; i < count; i++)
+			for (int c = 0; c < 4; c++)
+				sum[c] += weights[i] * texels[i][c];
+		for (int c = 0; c < 4; c++)
+			out[c] = sum[c];
+#endif
+	}
+
+	// runs f(first, last) on row ranges of rows rows, split between threads
+	template <typename F>
+	void parallelRows(int rows, int threads, F f)
+	{
+		threads = std::max(1, std::min(threads, rows / 16));
+		std::vector<std::thread> workers;
+		for (int t = 1; t < threads; t++)
+			workers.emplace_back(f, rows * t / threads, rows * (t + 1) / threads);
+		f(0, rows / threads);
+		for (std::thread& worker : workers)
+			worker.join();
+	}
+
+	inline float toLinear(uint8_t v)
+	{
+		static float table[256];
+		static bool initialized = [&]() {
+			for (int i = 0; i < 256; i++)
+			{
+				float c = i / 255.0f;
+				table[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+			return true;
+		}();
+		(void)initialized;
+		return table[v];
+	}
+
+	inline uint8_t toSrgb(float v)
+	{
+		// 16 bit steps are fine enough for the darkest 8 bit sRGB values
+		static uint8_t table[65536];
+		static bool initialized = [&]() {
+			for (int i = 0; i < 65536; i++)
+			{
+				float c = i / 65535.0f;
+				c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+				table[i] = (uint8_t)std::min(255.0f, c * 255.0f + 0.5f);
+			}
+			return true;
+		}();
+		(void)initialized;
+		return table[(int)(std::min(1.0f, std::max(0.0f, v)) * 65535.0f + 0.5f)];
+	}
+
+	// one level as RGBA floats
+	struct FloatImage
+	{
+		int width, height;
+		std::vector<float> texels;
+	};
+
+	inline FloatImage downsample(const FloatImage& source, MipFilter filter, bool wrap, int threads)
+	{
+		FloatImage result = { std::max(1, source.width / 2), std::max(1, source.height / 2), {} };
+		std::vector<Taps> columns = makeTaps(source.width, result.width, filter, wrap);
+		std::vector<Taps> rows = makeTaps(source.height, result.height, filter, wrap);
+
+		// horizontal into result.width x source.height, then vertical
+		std::vector<float> wide((size_t)result.width * source.height * 4);
+		parallelRows(source.height, threads, [&](int first, int last) {
+			std::vector<const float*> texels;
+			for (int y = first; y < last; y++)
+			{
+				for (int x = 0; x < result.width; x++)
+				{
+					const Taps& t = columns[x];
+					texels.resize(t.index.size());
+					for (size_t i = 0; i < t.index.size(); i++)
+						texels[i] = &source.texels[((size_t)y * source.width + t.index[i]) * 4];
+					accumulate(texels.data(), t.weight.data(), texels.size(), &wide[((size_t)y * result.width + x) * 4]);
+				}
+			}
+		});
+		result.texels.resize((size_t)result.width * result.height * 4);
+		parallelRows(result.height, threads, [&](int first, int last) {
+			std::vector<const float*> texels;
+			for (int y = first; y < last; y++)
+			{
+				const Taps& t = rows[y];
+				texels.resize(t.index.size());
+				for (int x = 0; x < result.width; x++)
+				{
+					for (size_t i = 0; i < t.index.size(); i++)
+						texels[i] = &wide[((size_t)t.index[i] * result.width + x) * 4];
+					accumulate(texels.data(), t.weight.data(), texels.size(), &result.texels[((size_t)y * result.width + x) * 4]);
+				}
+			}
+		});
+		return result;
+	}
+
+	inline void toFloat(const uint8_t* pixels, int count, int components, MipMode mode, float* out)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				float v = c < components ? pixels[i * components + c] / 255.0f : 1.0f;
+				// alpha (of RGBA or grey+alpha) is linear
+				bool alpha = (components == 4 && c == 3) || (components == 2 && c == 1);
+				if (mode == MIP_COLOR && c < components && !alpha)
+					v = toLinear(pixels[i * components + c]);
+				out[i * 4 + c] = v;
+			}
+		}
+	}
+
+	inline void toBytes(const float* texels, int count, int components, MipMode mode, uint8_t* out)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			float v[4] = { texels[i * 4], texels[i * 4 + 1], texels[i * 4 + 2], texels[i * 4 + 3] };
+			if (mode == MIP_NORMAL)
+			{
+				// back to a unit vector, the filter shortens (and the sinc lobes can stretch) the averaged normals
+				float n[3] = { v[0] * 2.0f - 1.0f, v[1] * 2.0f - 1.0f, v[2] * 2.0f - 1.0f };
+				float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+				if (length > 1e-6f)
+					for (int c = 0; c < 3; c++)
+						v[c] = (n[c] / length + 1.0f) * 0.5f;
+			}
+			for (int c = 0; c < components; c++)
+			{
+				bool alpha = (components == 4 && c == 3) || (components == 2 && c == 1);
+				out[i * components + c] = mode == MIP_COLOR && !alpha ? toSrgb(v[c])
+					: (uint8_t)(std::min(1.0f, std::max(0.0f, v[c])) * 255.0f + 0.5f);
+			}
+		}
+	}
+}
+
+// the full chain down to 1x1, level 0 is the image itself. wrap for textures that repeat.
+inline MipChain generateMips(const uint8_t* pixels, int width, int height, int components, MipMode mode,
+	MipFilter filter = FILTER_KAISER, bool wrap = true, int threads = 1)
+{
+	MipChain chain;
+	chain.width = width;
+	chain.height = height;
+	chain.components = components;
+	chain.levels = 1;
+	while (chain.levelWidth(chain.levels - 1) > 1 || chain.levelHeight(chain.levels - 1) > 1)
+		chain.levels++;
+	chain.data.resize(chain.levelOffset(chain.levels));
+	std::copy(pixels, pixels + chain.levelSize(0), chain.data.begin());
+
+	mips::FloatImage level = { width, height, std::vector<float>((size_t)width * height * 4) };
+	mips::toFloat(pixels, width * height, components, mode, level.texels.data());
+	for (int l = 1; l < chain.levels; l++)
+	{
+		level = mips::downsample(level, filter, wrap, threads);
+		mips::toBytes(level.texels.data(), level.width * level.height, components, mode, &chain.data[chain.levelOffset(l)]);
+		if (mode == MIP_NORMAL)
+		{
+			// the next level starts from the renormalized normals
+			mips::toFloat(&chain.data[chain.levelOffset(l)], level.width * level.height, components, mode, level.texels.data());
+		}
+	}
+	return chain;
+}
+
+#endif
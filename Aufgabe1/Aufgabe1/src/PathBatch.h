@@ -0,0 +1,258 @@
+#ifndef PATHBATCH_H
+#define PATHBATCH_H
+
+#include "CameraPath.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PATHBATCH_SSE
+#endif
+
+// Batch evaluation of the camera path for offline sampling (motion blur sub frames, previews, collision checks).
+// Positions and orientations for many parameter values are written into SoA output buffers,
+// the coefficients are read from the segment window of the CameraPath.
+// The same kernel is instantiated for plain floats, 4 wide SSE and 8 wide AVX2 (chosen at compile time,
+// /arch:AVX2 or -mavx2), the orientation is the same squad as glm::squad with polynomial sin/acos.
+
+// output buffers, each one holds n floats
+struct PathSamples
+{
+	float* px;
+	float* py;
+	float* pz;
+	float* qw;
+	float* qx;
+	float* qy;
+	float* qz;
+};
+
+namespace pathbatch
+{
+	// width-generic operations, select(a, b, x, y) returns a > b ? x : y per lane
+	struct ScalarOps
+	{
+		typedef float V;
+		static const int width = 1;
+		static V set(float a) { return a; }
+		static V load(const float* p) { return *p; }
+		static void store(float* p, V a) { *p = a; }
+		static V gather(const float* base, const int* index) { return base[*index]; }
+		static V add(V a, V b) { return a + b; }
+		static V sub(V a, V b) { return a - b; }
+		static V mul(V a, V b) { return a * b; }
+		static V madd(V a, V b, V c) { return a * b + c; }
+		static V div(V a, V b) { return a / b; }
+		static V sqrt(V a) { return std::sqrt(a); }
+		static V min(V a, V b) { return a < b ? a : b; }
+		static V select(V a, V b, V x, V y) { return a > b ? x : y; }
+	};
+
+#ifdef PATHBATCH_SSE
+	struct SseOps
+	{
+		typedef __m128 V;
+		static const int width = 4;
+		static V set(float a) { return _mm_set1_ps(a); }
+		static V load(const float* p) { return _mm_loadu_ps(p); }
+		static void store(float* p, V a) { _mm_storeu_ps(p, a); }
+		static V gather(const float* base, const int* index) { return _mm_setr_ps(base[index[0]], base[index[1]], base[index[2]], base[index[3]]); }
+		static V add(V a, V b) { return _mm_add_ps(a, b); }
+		static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+		static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+		static V madd(V a, V b, V c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+		static V div(V a, V b) { return _mm_div_ps(a, b); }
+		static V sqrt(V a) { return _mm_sqrt_ps(a); }
+		static V min(V a, V b) { return _mm_min_ps(a, b); }
+		static V select(V a, V b, V x, V y)
+		{
+			V mask = _mm_cmpgt_ps(a, b);
+			return _mm_or_ps(_mm_and_ps(mask, x), _mm_andnot_ps(mask, y));
+		}
+	};
+#endif
+
+#ifdef __AVX2__
+	struct AvxOps
+	{
+		typedef __m256 V;
+		static const int width = 8;
+		static V set(float a) { return _mm256_set1_ps(a); }
+		static V load(const float* p) { return _mm256_loadu_ps(p); }
+		static void store(float* p, V a) { _mm256_storeu_ps(p, a); }
+		static V gather(const float* base, const int* index) { return _mm256_i32gather_ps(base, _mm256_loadu_si256((const __m256i*)index), 4); }
+		static V add(V a, V b) { return _mm256_add_ps(a, b); }
+		static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+		static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+#if defined(__FMA__) || defined(_MSC_VER)
+		static V madd(V a, V b, V c) { return _mm256_fmadd_ps(a, b, c); }
+#else
+		static V madd(V a, V b, V c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+#endif
+		static V div(V a, V b) { return _mm256_div_ps(a, b); }
+		static V sqrt(V a) { return _mm256_sqrt_ps(a); }
+		static V min(V a, V b) { return _mm256_min_ps(a, b); }
+		static V select(V a, V b, V x, V y) { return _mm256_blendv_ps(y, x, _mm256_cmp_ps(a, b, _CMP_GT_OQ)); }
+	};
+	typedef AvxOps BestOps;
+#elif defined(PATHBATCH_SSE)
+	typedef SseOps BestOps;
+#else
+	typedef ScalarOps BestOps;
+#endif
+
+	// sin for x in [0, pi], odd Taylor polynomial on the half that is closer to 0
+	template <typename O>
+	typename O::V sin0pi(typename O::V x)
+	{
+		typedef typename O::V V;
+		x = O::min(x, O::sub(O::set(3.14159265f), x));
+		V x2 = O::mul(x, x);
+		V p = O::set(-2.5052108e-8f);
+		p = O::madd(p, x2, O::set(2.7557319e-6f));
+		p = O::madd(p, x2, O::set(-1.9841270e-4f));
+		p = O::madd(p, x2, O::set(8.3333333e-3f));
+		p = O::madd(p, x2, O::set(-1.6666667e-1f));
+		p = O::madd(p, x2, O::set(1.0f));
+		return O::mul(p, x);
+	}
+
+	// acos for x in [-1, 1] (Abramowitz & Stegun 4.4.46, error below 2e-8 on [0, 1])
+	template <typename O>
+	typename O::V acos(typename O::V x)
+	{
+		typedef typename O::V V;
+		V zero = O::set(0.0f);
+		V ax = O::select(x, zero, x, O::sub(zero, x));
+		V p = O::set(-0.0012624911f);
+		p = O::madd(p, ax, O::set(0.0066700901f));
+		p = O::madd(p, ax, O::set(-0.0170881256f));
+		p = O::madd(p, ax, O::set(0.0308918810f));
+		p = O::madd(p, ax, O::set(-0.0501743046f));
+		p = O::madd(p, ax, O::set(0.0889789874f));
+		p = O::madd(p, ax, O::set(-0.2145988016f));
+		p = O::madd(p, ax, O::set(1.5707963050f));
+		V r = O::mul(p, O::sqrt(O::sub(O::set(1.0f), ax)));
+		// acos(-x) = pi - acos(x)
+		return O::select(zero, x, O::sub(O::set(3.14159265f), r), r);
+	}
+
+	template <typename O>
+	struct Quat
+	{
+		typename O::V w, x, y, z;
+	};
+
+	// glm::mix for quaternions: slerp without taking the shortest arc, lerp when the angle is tiny
+	template <typename O>
+	Quat<O> mix(const Quat<O>& a, const Quat<O>& b, typename O::V h)
+	{
+		typedef typename O::V V;
+		V one = O::set(1.0f);
+		V cosTheta = O::madd(a.w, b.w, O::madd(a.x, b.x, O::madd(a.y, b.y, O::mul(a.z, b.z))));
+		V angle = acos<O>(O::min(cosTheta, one));
+		V inverseSin = O::div(one, sin0pi<O>(angle));
+		V slerpA = O::mul(sin0pi<O>(O::mul(O::sub(one, h), angle)), inverseSin);
+		V slerpB = O::mul(sin0pi<O>(O::mul(h, angle)), inverseSin);
+		// same threshold as glm (1 - epsilon)
+		V limit = O::set(1.0f - 1.1920929e-7f);
+		V wa = O::select(cosTheta, limit, O::sub(one, h), slerpA);
+		V wb = O::select(cosTheta, limit, h, slerpB);
+		Quat<O> r;
+		r.w = O::madd(a.w, wa, O::mul(b.w, wb));
+		r.x = O::madd(a.x, wa, O::mul(b.x, wb));
+		r.y = O::madd(a.y, wa, O::mul(b.y, wb));
+		r.z = O::madd(a.z, wa, O::mul(b.z, wb));
+		return r;
+	}
+
+	// evaluates width samples starting at i, load(stream) returns the coefficient of the sample's segment
+	template <typename O, typename Load>
+	void evaluateLanes(const CameraPath& path, Load load, const float* t, int i, const PathSamples& out)
+	{
+		typedef typename O::V V;
+		V h = O::load(t + i);
+
+		// position with Horner
+		V px = O::madd(O::madd(O::madd(load(path.stream(CameraPath::AX)), h, load(path.stream(CameraPath::BX))), h, load(path.stream(CameraPath::CX))), h, load(path.stream(CameraPath::DX)));
+		V py = O::madd(O::madd(O::madd(load(path.stream(CameraPath::AY)), h, load(path.stream(CameraPath::BY))), h, load(path.stream(CameraPath::CY))), h, load(path.stream(CameraPath::DY)));
+		V pz = O::madd(O::madd(O::madd(load(path.stream(CameraPath::AZ)), h, load(path.stream(CameraPath::BZ))), h, load(path.stream(CameraPath::CZ))), h, load(path.stream(CameraPath::DZ)));
+		O::store(out.px + i, px);
+		O::store(out.py + i, py);
+		O::store(out.pz + i, pz);
+
+		// squad(q0, q1, s0, s1, h) = mix(mix(q0, q1, h), mix(s0, s1, h), 2h(1 - h))
+		Quat<O> q0 = { load(path.stream(CameraPath::Q0W)), load(path.stream(CameraPath::Q0X)), load(path.stream(CameraPath::Q0Y)), load(path.stream(CameraPath::Q0Z)) };
+		Quat<O> q1 = { load(path.stream(CameraPath::Q1W)), load(path.stream(CameraPath::Q1X)), load(path.stream(CameraPath::Q1Y)), load(path.stream(CameraPath::Q1Z)) };
+		Quat<O> s0 = { load(path.stream(CameraPath::S0W)), load(path.stream(CameraPath::S0X)), load(path.stream(CameraPath::S0Y)), load(path.stream(CameraPath::S0Z)) };
+		Quat<O> s1 = { load(path.stream(CameraPath::S1W)), load(path.stream(CameraPath::S1X)), load(path.stream(CameraPath::S1Y)), load(path.stream(CameraPath::S1Z)) };
+		V h2 = O::mul(O::mul(O::set(2.0f), h), O::sub(O::set(1.0f), h));
+		Quat<O> q = mix<O>(mix<O>(q0, q1, h), mix<O>(s0, s1, h), h2);
+		O::store(out.qw + i, q.w);
+		O::store(out.qx + i, q.x);
+		O::store(out.qy + i, q.y);
+		O::store(out.qz + i, q.z);
+	}
+
+	// n parameter values of one segment
+	template <typename O>
+	void evaluateSegment(const CameraPath& path, int segment, const float* t, int n, const PathSamples& out)
+	{
+		int slot = path.resolve(segment);
+		int i = 0;
+		for (; i + O::width <= n; i += O::width)
+			evaluateLanes<O>(path, [slot](const float* s) { return O::set(s[slot]); }, t, i, out);
+		// remaining samples one by one
+		for (; i < n; i++)
+			evaluateLanes<ScalarOps>(path, [slot](const float* s) { return s[slot]; }, t, i, out);
+	}
+
+	// n (segment, t) pairs, segments can differ per sample
+	template <typename O>
+	void evaluate(const CameraPath& path, const int* segments, const float* t, int n, const PathSamples& out)
+	{
+		int i = 0;
+		for (; i + O::width <= n; i += O::width)
+		{
+			int slots[O::width];
+			for (int k = 0; k < O::width; k++)
+				slots[k] = path.resolve(segments[i + k]);
+			// lanes whose segments share a window slot evict each other, those go through the scalar path
+			bool resident = true;
+			for (int k = 0; k < O::width; k++)
+				resident = resident && path.isResident(segments[i + k], slots[k]);
+			if (resident)
+			{
+				evaluateLanes<O>(path, [&slots](const float* s) { return O::gather(s, slots); }, t, i, out);
+			}
+			else
+			{
+				for (int k = 0; k < O::width; k++)
+				{
+					int slot = path.resolve(segments[i + k]);
+					evaluateLanes<ScalarOps>(path, [slot](const float* s) { return s[slot]; }, t, i + k, out);
+				}
+			}
+		}
+		for (; i < n; i++)
+		{
+			int slot = path.resolve(segments[i]);
+			evaluateLanes<ScalarOps>(path, [slot](const float* s) { return s[slot]; }, t, i, out);
+		}
+	}
+}
+
+// evaluate n parameter values t[i] of one segment with the widest instruction set available
+inline void evaluateSegmentBatch(const CameraPath& path, int segment, const float* t, int n, const PathSamples& out)
+{
+	pathbatch::evaluateSegment<pathbatch::BestOps>(path, segment, t, n, out);
+}
+
+// evaluate n samples, sample i at parameter t[i] of segment segments[i]
+inline void evaluateBatch(const CameraPath& path, const int* segments, const float* t, int n, const PathSamples& out)
+{
+	pathbatch::evaluate<pathbatch::BestOps>(path, segments, t, n, out);
+}
+
+#endif
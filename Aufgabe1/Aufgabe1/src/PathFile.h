@@ -0,0 +1,104 @@
+#ifndef PATHFILE_H
+#define PATHFILE_H
+
+#include "CameraPath.h"
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// Binary camera path file, little endian:
+//   PathFileHeader
+//   float px[n], py[n], pz[n]              key positions
+//   float qw[n], qx[n], qy[n], qz[n]       key orientations
+//   float tension[n], bias[n], continuity[n]   only if PATHFILE_TCB is set
+// The arrays are used in place from the mapped file, nothing is copied at load time.
+
+const char PATHFILE_MAGIC[4] = { 'E', 'Z', 'G', 'P' };
+const uint32_t PATHFILE_VERSION = 1;
+const uint32_t PATHFILE_TCB = 1;
+
+struct PathFileHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t keyCount;
+	uint32_t flags;
+};
+
+// point keys at the arrays inside a mapped path file, returns false if the file is not a valid path
+inline bool readPathFile(const MappedFile& file, PathKeys& keys)
+{
+	if (!file.isOpen() || file.size() < sizeof(PathFileHeader))
+		return false;
+	PathFileHeader header;
+	std::memcpy(&header, file.data(), sizeof(header));
+	if (std::memcmp(header.magic, PATHFILE_MAGIC, 4) != 0 || header.version != PATHFILE_VERSION)
+	{
+		std::cout << "ERROR::PATHFILE::INVALID_HEADER" << std::endl;
+		return false;
+	}
+	uint64_t n = header.keyCount;
+	uint64_t arrays = (header.flags & PATHFILE_TCB) ? 10 : 7;
+	if (n < 4 || file.size() < sizeof(PathFileHeader) + arrays * n * sizeof(float))
+	{
+		std::cout << "ERROR::PATHFILE::TRUNCATED" << std::endl;
+		return false;
+	}
+
+	const float* data = (const float*)(file.data() + sizeof(PathFileHeader));
+	keys.count = (int)n;
+	keys.px = data;
+	keys.py = data + n;
+	keys.pz = data + 2 * n;
+	keys.qw = data + 3 * n;
+	keys.qx = data + 4 * n;
+	keys.qy = data + 5 * n;
+	keys.qz = data + 6 * n;
+	if (header.flags & PATHFILE_TCB)
+	{
+		keys.tension = data + 7 * n;
+		keys.bias = data + 8 * n;
+		keys.continuity = data + 9 * n;
+	}
+	else
+	{
+		keys.tension = keys.bias = keys.continuity = nullptr;
+	}
+	return true;
+}
+
+// write keys (e.g. a captured fly-through) into a path file, tcb may be null
+inline bool writePathFile(const char* path, const glm::vec3 positions[], const glm::quat orientations[], const glm::vec3 tcb[], int keyCount)
+{
+	std::ofstream out(path, std::ios::binary);
+	if (!out)
+		return false;
+	PathFileHeader header;
+	std::memcpy(header.magic, PATHFILE_MAGIC, 4);
+	header.version = PATHFILE_VERSION;
+	header.keyCount = (uint32_t)keyCount;
+	header.flags = tcb ? PATHFILE_TCB : 0;
+	out.write((const char*)&header, sizeof(header));
+
+	// one array per component
+	for (int k = 0; k < 3; k++)
+		for (int i = 0; i < keyCount; i++)
+			out.write((const char*)&positions[i][k], sizeof(float));
+	for (int k = 0; k < 4; k++)
+		for (int i = 0; i < keyCount; i++)
+		{
+			const glm::quat& q = orientations[i];
+			float v = k == 0 ? q.w : k == 1 ? q.x : k == 2 ? q.y : q.z;
+			out.write((const char*)&v, sizeof(float));
+		}
+	if (tcb)
+		for (int k = 0; k < 3; k++)
+			for (int i = 0; i < keyCount; i++)
+				out.write((const char*)&tcb[i][k], sizeof(float));
+	return (bool)out;
+}
+
+#endif
@@ -0,0 +1,299 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Shader.h"
+#include "GLState.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// passes in submission order, the pass is the most significant part of the sort key
+enum RenderPass
+{
+	PASS_SHADOW_STATIC,
+	PASS_SHADOW_DYNAMIC,
+	PASS_OPAQUE,
+	PASS_COUNT
+};
+
+// vertex array with attributes 0-3 (position, normal, uv, tangent), drawn as GL_TRIANGLES
+struct Mesh
+{
+	unsigned int vao;
+	int vertexCount;
+	// local bounding box, for culling
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+};
+
+// array textures bound to units 0 and 1 (diffuse, normal map) and the layer of this material in both (see
+// MaterialLibrary.h). Materials that only differ in the layer share a texture set and are drawn together.
+const int MATERIAL_TEXTURES = 2;
+struct Material
+{
+	unsigned int textures[MATERIAL_TEXTURES];
+	int layer;
+};
+
+// Collects draw packets for a frame, sorts them by a 64-bit key and submits them.
+// Key layout, most significant first:
+//   pass (4 bits) | program (8) | texture set (12) | mesh (8) | view depth (32, front to back)
+// After sorting, packets with the same upper 32 bits (same pass, program, texture set and mesh) are
+// merged into one instanced draw: the model matrices and material layers are written into instance
+// buffers in sorted order and the instance attributes (locations 4-7 and 8) are pointed at the start
+// of each run.
+// add() and sort() don't touch GL, so the list can be built on another thread; upload() and
+// submit() have to run on the render thread.
+class RenderQueue
+{
+public:
+	// program id 0 keeps the bound program (shadow passes, the caller binds the depth program),
+	// material id 0 keeps the bound textures (texture set 0)
+	static const unsigned int KEEP = 0;
+	// returned by the add functions when the id wouldn't fit into its key field, add() drops packets with it
+	static const unsigned int INVALID = 0xFFFFFFFF;
+	static const unsigned int MAX_PROGRAMS = 1 << 8;
+	static const unsigned int MAX_TEXTURE_SETS = 1 << 12;
+	static const unsigned int MAX_MESHES = 1 << 8;
+
+	RenderQueue()
+	{
+		programs.push_back(nullptr);
+		materials.push_back(Material());
+		textureSets.push_back(Material());
+		materialSets.push_back((unsigned int)KEEP);
+		glGenBuffers(1, &instanceBuffer);
+		glGenBuffers(1, &layerBuffer);
+	}
+
+	// frees the instance buffers, has to be called while the context is still alive
+	void release()
+	{
+		glDeleteBuffers(1, &instanceBuffer);
+		glDeleteBuffers(1, &layerBuffer);
+		instanceBuffer = 0;
+		layerBuffer = 0;
+	}
+
+	// registration at load time, the returned ids go into add()
+	unsigned int addProgram(Shader* program)
+	{
+		if (programs.size() >= MAX_PROGRAMS)
+		{
+			std::cout << "ERROR::RENDERQUEUE::TOO_MANY_PROGRAMS" << std::endl;
+			return INVALID;
+		}
+		programs.push_back(program);
+		return (unsigned int)programs.size() - 1;
+	}
+
+	unsigned int addMaterial(const Material& material)
+	{
+		unsigned int set = 1;
+		while (set < textureSets.size() && !std::equal(material.textures, material.textures + MATERIAL_TEXTURES, textureSets[set].textures))
+			set++;
+		if (set == textureSets.size())
+		{
+			if (set >= MAX_TEXTURE_SETS)
+			{
+				std::cout << "ERROR::RENDERQUEUE::TOO_MANY_TEXTURE_SETS" << std::endl;
+				return INVALID;
+			}
+			textureSets.push_back(material);
+		}
+		materials.push_back(material);
+		materialSets.push_back(set);
+		return (unsigned int)materials.size() - 1;
+	}
+
+	// enables the per instance model matrix and material layer on the mesh vao
+	unsigned int addMesh(const Mesh& mesh)
+	{
+		if (meshes.size() >= MAX_MESHES)
+		{
+			std::cout << "ERROR::RENDERQUEUE::TOO_MANY_MESHES" << std::endl;
+			return INVALID;
+		}
+		glState().bindVertexArray(mesh.vao);
+		for (unsigned int i = 0; i < 5; i++)
+		{
+			glEnableVertexAttribArray(4 + i);
+			glVertexAttribDivisor(4 + i, 1);
+		}
+		glState().bindVertexArray(0);
+		meshes.push_back(mesh);
+		return (unsigned int)meshes.size() - 1;
+	}
+
+	const Mesh& mesh(unsigned int id) const
+	{
+		return meshes[id];
+	}
+
+	// start a new frame
+	void clear()
+	{
+		keys.clear();
+		models.clear();
+		layers.clear();
+		drawCalls = 0;
+		triangles = 0;
+	}
+
+	// depth is the distance along the view direction, only used to order packets of the same state
+	void add(RenderPass pass, unsigned int program, unsigned int material, unsigned int mesh, const glm::mat4& model, float depth = 0.0f)
+	{
+		if (program >= programs.size() || material >= materials.size() || mesh >= meshes.size())
+			return;
+		uint64_t key = (uint64_t)pass << 60 | (uint64_t)(program & 0xFF) << 52 | (uint64_t)(materialSets[material] & 0xFFF) << 40 | (uint64_t)(mesh & 0xFF) << 32 | depthBits(depth);
+		keys.push_back(key);
+		models.push_back(model);
+		layers.push_back(materials[material].layer);
+	}
+
+	size_t size() const
+	{
+		return keys.size();
+	}
+
+	// stable LSD radix sort of the keys (8 bits per pass, passes where all keys share the digit are skipped),
+	// then the model matrices and layers are gathered in sorted order
+	void sort()
+	{
+		size_t n = keys.size();
+		order.resize(n);
+		for (size_t i = 0; i < n; i++)
+			order[i] = (uint32_t)i;
+		sortedKeys.resize(n);
+		sortedOrder.resize(n);
+
+		for (int shift = 0; shift < 64; shift += 8)
+		{
+			size_t counts[256] = {};
+			for (size_t i = 0; i < n; i++)
+				counts[(keys[i] >> shift) & 0xFF]++;
+			if (n == 0 || counts[(keys[0] >> shift) & 0xFF] == n)
+				continue;
+			size_t offsets[256];
+			size_t sum = 0;
+			for (int d = 0; d < 256; d++)
+			{
+				offsets[d] = sum;
+				sum += counts[d];
+			}
+			for (size_t i = 0; i < n; i++)
+			{
+				size_t slot = offsets[(keys[i] >> shift) & 0xFF]++;
+				sortedKeys[slot] = keys[i];
+				sortedOrder[slot] = order[i];
+			}
+			keys.swap(sortedKeys);
+			order.swap(sortedOrder);
+		}
+
+		sortedModels.resize(n);
+		sortedLayers.resize(n);
+		for (size_t i = 0; i < n; i++)
+		{
+			sortedModels[i] = models[order[i]];
+			sortedLayers[i] = layers[order[i]];
+		}
+
+		// first packet of every pass
+		size_t i = 0;
+		for (int pass = 0; pass <= PASS_COUNT; pass++)
+		{
+			while (i < n && (int)(keys[i] >> 60) < pass)
+				i++;
+			passStart[pass] = i;
+		}
+	}
+
+	// copy the sorted model matrices and layers into the instance buffers
+	void upload()
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+		// orphan the old storage so the driver doesn't wait for last frame's draws
+		glBufferData(GL_ARRAY_BUFFER, sortedModels.size() * sizeof(glm::mat4), NULL, GL_STREAM_DRAW);
+		if (!sortedModels.empty())
+			glBufferSubData(GL_ARRAY_BUFFER, 0, sortedModels.size() * sizeof(glm::mat4), &sortedModels[0][0][0]);
+		glBindBuffer(GL_ARRAY_BUFFER, layerBuffer);
+		glBufferData(GL_ARRAY_BUFFER, sortedLayers.size() * sizeof(int32_t), NULL, GL_STREAM_DRAW);
+		if (!sortedLayers.empty())
+			glBufferSubData(GL_ARRAY_BUFFER, 0, sortedLayers.size() * sizeof(int32_t), sortedLayers.data());
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	// draw all packets of a pass, one instanced call per run of equal state
+	void submit(RenderPass pass)
+	{
+		size_t end = passStart[pass + 1];
+		for (size_t i = passStart[pass]; i < end;)
+		{
+			uint64_t state = keys[i] >> 32;
+			size_t runEnd = i + 1;
+			while (runEnd < end && keys[runEnd] >> 32 == state)
+				runEnd++;
+
+			unsigned int program = (unsigned int)(state >> 20) & 0xFF;
+			unsigned int set = (unsigned int)(state >> 8) & 0xFFF;
+			const Mesh& mesh = meshes[state & 0xFF];
+			if (program != KEEP)
+				programs[program]->use();
+			if (set != KEEP)
+				for (int t = 0; t < MATERIAL_TEXTURES; t++)
+					glState().bindTexture(t, GL_TEXTURE_2D_ARRAY, textureSets[set].textures[t]);
+
+			glState().bindVertexArray(mesh.vao);
+			glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+			// per instance model matrix, one vec4 column per attribute, starting at the first matrix of the run
+			for (unsigned int c = 0; c < 4; c++)
+				glVertexAttribPointer(4 + c, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(i * sizeof(glm::mat4) + c * sizeof(glm::vec4)));
+			glBindBuffer(GL_ARRAY_BUFFER, layerBuffer);
+			glVertexAttribIPointer(8, 1, GL_INT, sizeof(int32_t), (void*)(i * sizeof(int32_t)));
+			glDrawArraysInstanced(GL_TRIANGLES, 0, mesh.vertexCount, (GLsizei)(runEnd - i));
+
+			drawCalls++;
+			triangles += (unsigned long long)(mesh.vertexCount / 3) * (runEnd - i);
+			i = runEnd;
+		}
+	}
+
+	// draw calls and triangles submitted since clear()
+	unsigned long long drawCalls = 0;
+	unsigned long long triangles = 0;
+
+private:
+	// non negative floats keep their order when compared as unsigned integers
+	static uint32_t depthBits(float depth)
+	{
+		if (!(depth > 0.0f))
+			return 0;
+		uint32_t bits;
+		std::memcpy(&bits, &depth, sizeof(bits));
+		return bits;
+	}
+
+	std::vector<Shader*> programs;
+	std::vector<Material> materials;
+	// distinct texture combinations (the key holds these), the texture set of every material
+	std::vector<Material> textureSets;
+	std::vector<unsigned int> materialSets;
+	std::vector<Mesh> meshes;
+
+	std::vector<uint64_t> keys, sortedKeys;
+	std::vector<uint32_t> order, sortedOrder;
+	std::vector<glm::mat4> models, sortedModels;
+	std::vector<int32_t> layers, sortedLayers;
+	size_t passStart[PASS_COUNT + 1] = {};
+	unsigned int instanceBuffer = 0;
+	unsigned int layerBuffer = 0;
+};
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef RENDERTARGET_H
+#define RENDERTARGET_H
+
+#include <glad/glad.h>
+
+#include "GLState.h"
+
+#include <algorithm>
+
+// Where the lit pass renders to. With multisampling a framebuffer with multisampled color and depth renderbuffers,
+// resolve() blits it into the output; without multisampling the pass draws straight into the output and
+// no extra memory is used. The output is the window (framebuffer 0) or, for offscreen rendering, a single
+// sampled framebuffer of its own. The size and the sample count can be changed at any time with resize(), the window
+// and the context stay the same (the window itself is created without samples).
+class RenderTarget
+{
+public:
+	explicit RenderTarget(bool offscreen)
+		: offscreen(offscreen)
+	{
+	}
+
+	// (re)creates the renderbuffers, samples is clamped to GL_MAX_SAMPLES, 0 disables multisampling.
+	// false if a framebuffer is not complete
+	bool resize(int width, int height, int samples)
+	{
+		GLint maxSamples = 0;
+		glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+		samples = std::max(0, std::min(samples, (int)maxSamples));
+		if (width == targetWidth && height == targetHeight && samples == sampleCount)
+			return true;
+
+		release();
+		targetWidth = width;
+		targetHeight = height;
+		sampleCount = samples;
+		bool complete = true;
+		if (offscreen)
+			complete = create(0, outputFBO, outputRenderbuffers);
+		if (sampleCount > 0)
+			complete = create(sampleCount, multisampleFBO, multisampleRenderbuffers) && complete;
+		return complete;
+	}
+
+	// the framebuffer the scene is drawn into
+	GLuint framebuffer() const
+	{
+		return sampleCount > 0 ? multisampleFBO : outputFBO;
+	}
+
+	// the framebuffer that holds the final image after resolve()
+	GLuint output() const
+	{
+		return outputFBO;
+	}
+
+	int samples() const
+	{
+		return sampleCount;
+	}
+
+	int width() const
+	{
+		return targetWidth;
+	}
+
+	int height() const
+	{
+		return targetHeight;
+	}
+
+	// averages the samples into the output, only color is resolved. Leaves the output bound.
+	void resolve()
+	{
+		if (sampleCount > 0)
+		{
+			glState().bindFramebuffer(GL_READ_FRAMEBUFFER, multisampleFBO);
+			glState().bindFramebuffer(GL_DRAW_FRAMEBUFFER, outputFBO);
+			glBlitFramebuffer(0, 0, targetWidth, targetHeight, 0, 0, targetWidth, targetHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		}
+		glState().bindFramebuffer(GL_FRAMEBUFFER, outputFBO);
+	}
+
+	// frees the framebuffers and renderbuffers, has to be called while the context is still alive
+	void release()
+	{
+		destroy(multisampleFBO, multisampleRenderbuffers);
+		destroy(outputFBO, outputRenderbuffers);
+		sampleCount = 0;
+		targetWidth = targetHeight = 0;
+	}
+
+private:
+	// color and depth renderbuffers with the given sample count in a framebuffer
+	bool create(int samples, GLuint& fbo, GLuint renderbuffers[2])
+	{
+		glGenFramebuffers(1, &fbo);
+		glGenRenderbuffers(2, renderbuffers);
+		glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+		glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, targetWidth, targetHeight);
+		glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+		glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH_COMPONENT24, targetWidth, targetHeight);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+		glState().bindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+		bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+		glState().bindFramebuffer(GL_FRAMEBUFFER, 0);
+		return complete;
+	}
+
+	void destroy(GLuint& fbo, GLuint renderbuffers[2])
+	{
+		if (fbo == 0)
+			return;
+		glState().forgetFramebuffer(fbo);
+		glDeleteFramebuffers(1, &fbo);
+		glDeleteRenderbuffers(2, renderbuffers);
+		fbo = 0;
+		renderbuffers[0] = renderbuffers[1] = 0;
+	}
+
+	bool offscreen;
+	int targetWidth = 0;
+	int targetHeight = 0;
+	int sampleCount = 0;
+	GLuint multisampleFBO = 0;
+	GLuint multisampleRenderbuffers[2] = { 0, 0 };
+	GLuint outputFBO = 0;
+	GLuint outputRenderbuffers[2] = { 0, 0 };
+};
+
+#endif
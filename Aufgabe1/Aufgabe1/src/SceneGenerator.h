@@ -0,0 +1,169 @@
+#ifndef SCENEGENERATOR_H
+#define SCENEGENERATOR_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+// Procedural stress scenes: N cubes laid out as a grid, random clusters or towers, and optionally a camera
+// path that loops over them. The same layout, count and seed always give the same scene (the random
+// numbers come straight from mt19937, whose output is fixed by the standard, the distributions are not).
+
+enum SceneLayout
+{
+	SCENE_DEMO,
+	SCENE_GRID,
+	SCENE_CLUSTERS,
+	SCENE_TOWERS
+};
+
+// "grid", "clusters" or "towers", false for anything else
+inline bool parseSceneLayout(const std::string& name, SceneLayout& layout)
+{
+	if (name == "grid")
+		layout = SCENE_GRID;
+	else if (name == "clusters")
+		layout = SCENE_CLUSTERS;
+	else if (name == "towers")
+		layout = SCENE_TOWERS;
+	else
+		return false;
+	return true;
+}
+
+struct GeneratedScene
+{
+	// cube centers, unit cubes
+	std::vector<glm::vec3> cubes;
+	// bounds of the centers
+	glm::vec3 min;
+	glm::vec3 max;
+	// camera keys, only filled by generatePath
+	std::vector<glm::vec3> pathPositions;
+	std::vector<glm::quat> pathOrientations;
+};
+
+class SceneGenerator
+{
+public:
+	// distance between neighbouring cubes in the grid and between towers
+	static constexpr float SPACING = 3.0f;
+	static const int MAX_TOWER_HEIGHT = 20;
+	static const int CLUSTER_SIZE = 500;
+	static const int PATH_KEYS = 24;
+
+	SceneGenerator(unsigned int seed)
+		: random(seed)
+	{
+	}
+
+	GeneratedScene generate(SceneLayout layout, int count)
+	{
+		GeneratedScene scene;
+		scene.cubes.reserve(count);
+		// side of the square the cubes are spread over, the same density for every layout
+		int side = (int)std::ceil(std::sqrt((float)count));
+		float extent = side * SPACING;
+
+		if (layout == SCENE_GRID)
+		{
+			for (int i = 0; i < count; i++)
+				scene.cubes.push_back(glm::vec3((i % side) * SPACING - extent * 0.5f, 0.0f, (i / side) * SPACING - extent * 0.5f));
+		}
+		else if (layout == SCENE_CLUSTERS)
+		{
+			float radius = std::sqrt((float)CLUSTER_SIZE) * 0.75f;
+			while ((int)scene.cubes.size() < count)
+			{
+				glm::vec3 center(uniform(-0.5f, 0.5f) * extent, uniform(0.0f, 10.0f), uniform(-0.5f, 0.5f) * extent);
+				for (int i = 0; i < CLUSTER_SIZE && (int)scene.cubes.size() < count; i++)
+				{
+					// sum of three uniforms, roughly normal around the center
+					glm::vec3 offset(0.0f);
+					for (int k = 0; k < 3; k++)
+						offset += glm::vec3(uniform(-1.0f, 1.0f), uniform(-0.5f, 0.5f), uniform(-1.0f, 1.0f));
+					scene.cubes.push_back(center + offset * radius / 3.0f);
+				}
+			}
+		}
+		else if (layout == SCENE_TOWERS)
+		{
+			// towers on a coarser grid so the average height fits the cube count into the same area
+			int towerSide = std::max(1, (int)std::ceil(std::sqrt(count / (MAX_TOWER_HEIGHT * 0.5f))));
+			float towerSpacing = extent / towerSide;
+			// cubes stacked on each grid cell so far, once the grid is full the next round of towers goes on top
+			std::vector<int> stacked((size_t)towerSide * towerSide, 0);
+			for (int t = 0; (int)scene.cubes.size() < count; t++)
+			{
+				int& top = stacked[t % stacked.size()];
+				glm::vec3 base((t % towerSide) * towerSpacing - extent * 0.5f, (float)top, (t / towerSide % towerSide) * towerSpacing - extent * 0.5f);
+				int height = 1 + (int)(uniform(0.0f, 1.0f) * MAX_TOWER_HEIGHT) % MAX_TOWER_HEIGHT;
+				for (int level = 0; level < height && (int)scene.cubes.size() < count; level++, top++)
+					scene.cubes.push_back(base + glm::vec3(0.0f, (float)level, 0.0f));
+			}
+		}
+
+		scene.min = glm::vec3(0.0f);
+		scene.max = glm::vec3(0.0f);
+		if (!scene.cubes.empty())
+		{
+			scene.min = scene.max = scene.cubes[0];
+			for (const glm::vec3& cube : scene.cubes)
+			{
+				scene.min = glm::min(scene.min, cube);
+				scene.max = glm::max(scene.max, cube);
+			}
+		}
+		return scene;
+	}
+
+	// closed loop over the scene (PATH_KEYS keys and the first three again), a bit above the highest cube,
+	// looking ahead and down. scale is applied to the positions (shader.vs draws everything at twice its model position, see main.cpp)
+	void generatePath(GeneratedScene& scene, float scale)
+	{
+		glm::vec3 center = (scene.min + scene.max) * 0.5f * scale;
+		glm::vec2 radius = glm::max(glm::vec2(scene.max.x - scene.min.x, scene.max.z - scene.min.z) * 0.35f * scale, glm::vec2(5.0f));
+		float height = scene.max.y * scale + 3.0f;
+
+		scene.pathPositions.clear();
+		scene.pathOrientations.clear();
+		for (int i = 0; i < PATH_KEYS; i++)
+		{
+			float angle = 6.2831853f * i / PATH_KEYS;
+			// wobble in and out and up and down so the path isn't a plain circle
+			float r = 1.0f + uniform(-0.15f, 0.15f);
+			scene.pathPositions.push_back(glm::vec3(center.x + std::cos(angle) * radius.x * r, height + uniform(0.0f, 3.0f), center.z + std::sin(angle) * radius.y * r));
+		}
+		for (int i = 0; i < PATH_KEYS; i++)
+		{
+			glm::vec3 ahead = scene.pathPositions[(i + 1) % PATH_KEYS] - scene.pathPositions[(i + PATH_KEYS - 1) % PATH_KEYS];
+			glm::vec3 dir = glm::normalize(glm::vec3(ahead.x, 0.0f, ahead.z)) + glm::vec3(0.0f, -0.3f, 0.0f);
+			scene.pathOrientations.push_back(glm::rotation(glm::vec3(0.0f, 0.0f, -1.0f), glm::normalize(dir)));
+		}
+		// the first and last key only shape tangents, repeating the first three keys makes the segments from the last key
+		// back to key 1 real ones, the end of the path then continues smoothly into its start
+		for (int i = 0; i < 3; i++)
+		{
+			scene.pathPositions.push_back(scene.pathPositions[i]);
+			scene.pathOrientations.push_back(scene.pathOrientations[i]);
+		}
+	}
+
+private:
+	// uniform in [lo, hi)
+	float uniform(float lo, float hi)
+	{
+		return lo + (hi - lo) * (float)(random() / 4294967296.0);
+	}
+
+	std::mt19937 random;
+};
+
+#endif
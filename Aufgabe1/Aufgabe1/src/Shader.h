@@ -4,10 +4,43 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "GLState.h"
+
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// FNV-1a hash of a uniform name, usable at compile time
+constexpr uint32_t uniformHash(const char* name, uint32_t hash = 2166136261u)
+{
+    return *name ? uniformHash(name + 1, (hash ^ (uint32_t)(unsigned char)*name) * 16777619u) : hash;
+}
+
+// uniform name hashed at compile time, e.g. shader.setMat4("view"_uniform, view)
+struct UniformName
+{
+    uint32_t hash;
+    // the spelled out name, compared on a hash hit in debug builds
+    const char* name;
+    constexpr explicit UniformName(uint32_t h, const char* n = nullptr) : hash(h), name(n) {}
+};
+
+constexpr UniformName operator"" _uniform(const char* name, std::size_t)
+{
+    return UniformName(uniformHash(name), name);
+}
+
+// uniform location resolved once with Shader::uniform<T>(), T is the type it is set with
+template <typename T>
+struct Uniform
+{
+    GLint location = -1;
+    bool valid() const { return location >= 0; }
+};
 
 class Shader
 {
@@ -89,6 +122,7 @@ public:
             glAttachShader(ID, geometry);
         glLinkProgram(ID);
         checkCompileErrors(ID, "PROGRAM");
+        reflectUniforms();
         // delete the shaders as they're linked into our program now and no longer necessery
         glDeleteShader(vertex);
         glDeleteShader(fragment);
@@ -100,68 +134,304 @@ public:
     // ------------------------------------------------------------------------
     void use()
     {
-        glUseProgram(ID);
+        glState().useProgram(ID);
+    }
+    // connect a uniform block to a binding point (GL 3.3 has no layout(binding = n) for blocks)
+    // ------------------------------------------------------------------------
+    void bindUniformBlock(const char* name, GLuint binding) const
+    {
+        GLuint index = glGetUniformBlockIndex(ID, name);
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(ID, index, binding);
+    }
+    // location of an active uniform, -1 if the program has no such uniform (like glGetUniformLocation).
+    // Looked up in the table built at link time, no driver call.
+    // ------------------------------------------------------------------------
+    GLint location(UniformName name) const
+    {
+        const UniformInfo* info = findUniform(name.hash, name.name);
+        return info ? info->location : -1;
+    }
+    GLint location(const char* name) const
+    {
+        return location(UniformName(uniformHash(name), name));
+    }
+    // resolve a typed handle once and reuse it every frame
+    // ------------------------------------------------------------------------
+    template <typename T>
+    Uniform<T> uniform(const char* name) const
+    {
+        Uniform<T> handle;
+        const UniformInfo* info = findUniform(uniformHash(name), name);
+        if (info == nullptr)
+            return handle;
+        if (!typeMatches(info->type, T()))
+        {
+            std::cout << "ERROR::SHADER::UNIFORM_TYPE_MISMATCH: " << name << std::endl;
+            return handle;
+        }
+        handle.location = info->location;
+        return handle;
     }
     // utility uniform functions
     // ------------------------------------------------------------------------
+    template <typename T>
+    void set(const Uniform<T>& uniform, const T& value) const
+    {
+        upload(uniform.location, value);
+    }
+    // ------------------------------------------------------------------------
     void setBool(const std::string& name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        upload(location(name.c_str()), value);
+    }
+    void setBool(UniformName name, bool value) const
+    {
+        upload(location(name), value);
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string& name, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        upload(location(name.c_str()), value);
+    }
+    void setInt(UniformName name, int value) const
+    {
+        upload(location(name), value);
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string& name, float value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        upload(location(name.c_str()), value);
+    }
+    void setFloat(UniformName name, float value) const
+    {
+        upload(location(name), value);
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string& name, const glm::vec2& value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        upload(location(name.c_str()), value);
+    }
+    void setVec2(UniformName name, const glm::vec2& value) const
+    {
+        upload(location(name), value);
     }
     void setVec2(const std::string& name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        upload(location(name.c_str()), glm::vec2(x, y));
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string& name, const glm::vec3& value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        upload(location(name.c_str()), value);
+    }
+    void setVec3(UniformName name, const glm::vec3& value) const
+    {
+        upload(location(name), value);
     }
     void setVec3(const std::string& name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        upload(location(name.c_str()), glm::vec3(x, y, z));
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string& name, const glm::vec4& value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        upload(location(name.c_str()), value);
+    }
+    void setVec4(UniformName name, const glm::vec4& value) const
+    {
+        upload(location(name), value);
     }
     void setVec4(const std::string& name, float x, float y, float z, float w)
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        upload(location(name.c_str()), glm::vec4(x, y, z, w));
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string& name, const glm::mat2& mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        upload(location(name.c_str()), mat);
+    }
+    void setMat2(UniformName name, const glm::mat2& mat) const
+    {
+        upload(location(name), mat);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string& name, const glm::mat3& mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        upload(location(name.c_str()), mat);
+    }
+    void setMat3(UniformName name, const glm::mat3& mat) const
+    {
+        upload(location(name), mat);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string& name, const glm::mat4& mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        upload(location(name.c_str()), mat);
+    }
+    void setMat4(UniformName name, const glm::mat4& mat) const
+    {
+        upload(location(name), mat);
+    }
+    // whole mat4 array starting at element 0
+    void setMat4Array(UniformName name, const glm::mat4* mats, int count) const
+    {
+        glUniformMatrix4fv(location(name), count, GL_FALSE, &mats[0][0][0]);
     }
 
 private:
+    // one slot of the open addressing table, type 0 marks an empty slot
+    struct UniformInfo
+    {
+        uint32_t hash;
+        GLint location;
+        GLenum type;
+        std::string name;
+    };
+    std::vector<UniformInfo> uniforms;
+    size_t uniformCount = 0;
+
+    // enumerate the active uniforms after linking, array elements get an entry each ("a", "a[0]", "a[1]", ...)
+    // ------------------------------------------------------------------------
+    void reflectUniforms()
+    {
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        // power of two, at most half full
+        size_t capacity = 16;
+        while (capacity < (size_t)count * 4)
+            capacity *= 2;
+        uniforms.assign(capacity, UniformInfo{ 0, -1, 0, {} });
+        uniformCount = 0;
+
+        std::vector<GLchar> buffer(maxLength + 1);
+        for (GLint i = 0; i < count; i++)
+        {
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(ID, i, (GLsizei)buffer.size(), NULL, &size, &type, buffer.data());
+            std::string name = buffer.data();
+            GLint loc = glGetUniformLocation(ID, name.c_str());
+            // members of uniform blocks have no location
+            if (loc < 0)
+                continue;
+            insertUniform(name, loc, type);
+            if (size > 1 || name.back() == ']')
+            {
+                std::string base = name.substr(0, name.find('['));
+                insertUniform(name == base ? base + "[0]" : base, loc, type);
+                for (GLint e = 1; e < size; e++)
+                {
+                    std::string element = base + "[" + std::to_string(e) + "]";
+                    insertUniform(element, glGetUniformLocation(ID, element.c_str()), type);
+                }
+            }
+        }
+    }
+    void insertUniform(const std::string& name, GLint loc, GLenum type)
+    {
+        if (uniforms.size() < 2 * (uniformCount + 1))
+            growUniforms();
+        uint32_t hash = uniformHash(name.c_str());
+        size_t mask = uniforms.size() - 1;
+        for (size_t slot = hash & mask;; slot = (slot + 1) & mask)
+        {
+            if (uniforms[slot].type == 0)
+            {
+                uniforms[slot] = UniformInfo{ hash, loc, type, name };
+                uniformCount++;
+                return;
+            }
+            if (uniforms[slot].hash == hash)
+            {
+                if (uniforms[slot].name == name)
+                    return;
+                std::cout << "ERROR::SHADER::UNIFORM_HASH_COLLISION: " << name << std::endl;
+                return;
+            }
+        }
+    }
+    void growUniforms()
+    {
+        std::vector<UniformInfo> old;
+        old.swap(uniforms);
+        uniforms.assign(old.size() * 2, UniformInfo{ 0, -1, 0, {} });
+        size_t mask = uniforms.size() - 1;
+        for (UniformInfo& info : old)
+        {
+            if (info.type == 0)
+                continue;
+            size_t slot = info.hash & mask;
+            while (uniforms[slot].type != 0)
+                slot = (slot + 1) & mask;
+            uniforms[slot] = std::move(info);
+        }
+    }
+    // name (if known) is checked against the stored one in debug builds, a different name with the same hash
+    // means the uniform asked for isn't in the table
+    const UniformInfo* findUniform(uint32_t hash, const char* name) const
+    {
+        if (uniforms.empty())
+            return nullptr;
+        size_t mask = uniforms.size() - 1;
+        for (size_t slot = hash & mask;; slot = (slot + 1) & mask)
+        {
+            const UniformInfo& info = uniforms[slot];
+            if (info.type == 0)
+                return nullptr;
+            if (info.hash == hash)
+            {
+#ifndef NDEBUG
+                if (name != nullptr && info.name != name)
+                {
+                    std::cout << "ERROR::SHADER::UNIFORM_HASH_COLLISION: " << name << " / " << info.name << std::endl;
+                    return nullptr;
+                }
+#else
+                (void)name;
+#endif
+                return &info;
+            }
+        }
+    }
+
+    // glUniform* call for every supported type, location -1 is ignored by GL
+    // ------------------------------------------------------------------------
+    static void upload(GLint loc, bool value) { glUniform1i(loc, (int)value); }
+    static void upload(GLint loc, int value) { glUniform1i(loc, value); }
+    static void upload(GLint loc, float value) { glUniform1f(loc, value); }
+    static void upload(GLint loc, const glm::vec2& value) { glUniform2fv(loc, 1, &value[0]); }
+    static void upload(GLint loc, const glm::vec3& value) { glUniform3fv(loc, 1, &value[0]); }
+    static void upload(GLint loc, const glm::vec4& value) { glUniform4fv(loc, 1, &value[0]); }
+    static void upload(GLint loc, const glm::mat2& mat) { glUniformMatrix2fv(loc, 1, GL_FALSE, &mat[0][0]); }
+    static void upload(GLint loc, const glm::mat3& mat) { glUniformMatrix3fv(loc, 1, GL_FALSE, &mat[0][0]); }
+    static void upload(GLint loc, const glm::mat4& mat) { glUniformMatrix4fv(loc, 1, GL_FALSE, &mat[0][0]); }
+
+    // whether a uniform of the reflected GL type can be set with the given C++ type
+    // ------------------------------------------------------------------------
+    static bool typeMatches(GLenum type, bool) { return type == GL_BOOL; }
+    static bool typeMatches(GLenum type, int)
+    {
+        // samplers are set with their texture unit
+        switch (type)
+        {
+        case GL_INT: case GL_BOOL:
+        case GL_SAMPLER_2D: case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_2D_ARRAY_SHADOW:
+        case GL_SAMPLER_3D: case GL_SAMPLER_CUBE: case GL_SAMPLER_2D_MULTISAMPLE:
+            return true;
+        default:
+            return false;
+        }
+    }
+    static bool typeMatches(GLenum type, float) { return type == GL_FLOAT; }
+    static bool typeMatches(GLenum type, const glm::vec2&) { return type == GL_FLOAT_VEC2; }
+    static bool typeMatches(GLenum type, const glm::vec3&) { return type == GL_FLOAT_VEC3; }
+    static bool typeMatches(GLenum type, const glm::vec4&) { return type == GL_FLOAT_VEC4; }
+    static bool typeMatches(GLenum type, const glm::mat2&) { return type == GL_FLOAT_MAT2; }
+    static bool typeMatches(GLenum type, const glm::mat3&) { return type == GL_FLOAT_MAT3; }
+    static bool typeMatches(GLenum type, const glm::mat4&) { return type == GL_FLOAT_MAT4; }
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
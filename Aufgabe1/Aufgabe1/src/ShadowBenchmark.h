@@ -0,0 +1,121 @@
+#ifndef SHADOWBENCHMARK_H
+#define SHADOWBENCHMARK_H
+
+#include <glad/glad.h>
+
+#include <iostream>
+#include <iomanip>
+
+// Measures the GPU time of the lighting pass for every combination of shadow map format and PCF
+// kernel size with GL_TIME_ELAPSED queries. Each mode is shown for WARMUP_FRAMES frames (shadow map
+// re-render, shader warm up) and then timed for MEASURED_FRAMES frames. Run with --timescale 0 so
+// every mode sees the same view.
+class ShadowBenchmark
+{
+public:
+	static const int FORMAT_COUNT = 3;
+	static const int TAP_COUNT = 4;
+	static const int WARMUP_FRAMES = 10;
+	static const int MEASURED_FRAMES = 100;
+
+	ShadowBenchmark()
+	{
+		for (int f = 0; f < FORMAT_COUNT; f++)
+			for (int t = 0; t < TAP_COUNT; t++)
+				results[f][t] = 0.0;
+	}
+
+	void start()
+	{
+		glGenQueries(1, &query);
+		running = true;
+		mode = 0;
+		frame = 0;
+	}
+
+	bool active() const
+	{
+		return running;
+	}
+
+	// format and kernel size to render the current frame with
+	GLenum format() const
+	{
+		return formats()[mode / TAP_COUNT];
+	}
+
+	int taps() const
+	{
+		return tapCounts()[mode % TAP_COUNT];
+	}
+
+	// wrap the pass that is measured
+	void beginPass()
+	{
+		if (running && frame >= WARMUP_FRAMES)
+			glBeginQuery(GL_TIME_ELAPSED, query);
+	}
+
+	// pixels is the number of shaded pixels, returns false when all modes are done
+	bool endPass(unsigned int pixels)
+	{
+		if (!running)
+			return false;
+		if (frame >= WARMUP_FRAMES)
+		{
+			glEndQuery(GL_TIME_ELAPSED);
+			// waits for the gpu, fine while benchmarking
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+			results[mode / TAP_COUNT][mode % TAP_COUNT] += (double)elapsed / MEASURED_FRAMES;
+		}
+		if (++frame == WARMUP_FRAMES + MEASURED_FRAMES)
+		{
+			frame = 0;
+			if (++mode == FORMAT_COUNT * TAP_COUNT)
+			{
+				report(pixels);
+				glDeleteQueries(1, &query);
+				running = false;
+				return false;
+			}
+		}
+		return true;
+	}
+
+private:
+	static const GLenum* formats()
+	{
+		static const GLenum f[FORMAT_COUNT] = { GL_DEPTH_COMPONENT16, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT32F };
+		return f;
+	}
+
+	static const int* tapCounts()
+	{
+		static const int t[TAP_COUNT] = { 1, 4, 9, 16 };
+		return t;
+	}
+
+	// average pass time per mode and the cost per shaded pixel
+	void report(unsigned int pixels)
+	{
+		const char* names[FORMAT_COUNT] = { "DEPTH_COMPONENT16", "DEPTH_COMPONENT24", "DEPTH_COMPONENT32F" };
+		std::cout << "shadow benchmark, lighting pass over " << MEASURED_FRAMES << " frames, " << pixels << " pixels" << std::endl;
+		for (int f = 0; f < FORMAT_COUNT; f++)
+			for (int t = 0; t < TAP_COUNT; t++)
+			{
+				double ns = results[f][t];
+				std::cout << std::left << std::setw(20) << names[f] << std::setw(2) << tapCounts()[t] << " taps: "
+					<< std::fixed << std::setprecision(3) << ns / 1000000.0 << " ms, "
+					<< std::setprecision(4) << ns / pixels << " ns/pixel" << std::endl;
+			}
+	}
+
+	unsigned int query = 0;
+	bool running = false;
+	int mode = 0;
+	int frame = 0;
+	double results[FORMAT_COUNT][TAP_COUNT];
+};
+
+#endif
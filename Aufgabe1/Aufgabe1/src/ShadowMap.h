@@ -0,0 +1,342 @@
+#ifndef SHADOWMAP_H
+#define SHADOWMAP_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Shader.h"
+
+#include <algorithm>
+#include <cmath>
+
+// has to match MAX_CASCADES in depthShader.gs, shader.vs and shader.fs
+const int MAX_CASCADES = 4;
+
+// Cascaded shadow map for a directional light, one layer of a depth texture array per cascade.
+// fit() splits the camera frustum into slices and fits an orthographic light projection around the
+// bounding sphere of each slice. The sphere only depends on the slice distances, so the extent and the
+// texel size of a cascade stay the same while the camera turns, and its origin is snapped to whole
+// texels in light space, which keeps the shadow edges from swimming. The near cascades are refitted every frame, the distant ones only every
+// refreshInterval frames (staggered), until then a cascade keeps the matrix it was rendered with.
+// update() renders all cascades that changed in one layered pass, the depth geometry shader copies
+// each triangle into every cascade selected by cascadeMask.
+// Changed cascade matrices are detected automatically, moved casters have to be reported with
+// invalidateStatic()/invalidateDynamic(). As long as there are no dynamic casters the static casters
+// go straight into the depth map. With dynamic casters the static ones are cached in a second depth
+// texture array, updating the dynamic casters copies that cache into the depth map and only draws
+// the dynamic casters on top.
+// The depth texture is sampled with depth compare (sampler2DArrayShadow), every tap returns bilinear PCF
+// of the 4 nearest texels.
+class ShadowMap
+{
+public:
+	unsigned int width, height;
+	int cascadeCount;
+	// cascades from this index on are only refitted every refreshInterval frames
+	int firstDistantCascade = 2;
+	int refreshInterval = 4;
+	// blend between uniform (0) and logarithmic (1) split distances
+	float splitLambda = 0.75f;
+	// how far behind a slice (towards the light) casters are still captured
+	float casterDistance = 200.0f;
+
+	ShadowMap(unsigned int w, unsigned int h, int cascades = MAX_CASCADES, GLenum format = GL_DEPTH_COMPONENT24)
+		: width(w), height(h), cascadeCount(std::min(std::max(cascades, 1), MAX_CASCADES)), depthFormat(format)
+	{
+		createTarget(depthMap, depthMapFBO, layerFBO);
+		for (int c = 0; c < MAX_CASCADES; c++)
+		{
+			lightSpaceMatrices[c] = glm::mat4(0.0f);
+			splits[c] = 0.0f;
+		}
+	}
+
+	// frees the gl objects, has to be called while the context is still alive
+	void release()
+	{
+		releaseTarget(depthMap, depthMapFBO, layerFBO);
+		if (staticFBO)
+			releaseTarget(staticDepth, staticFBO, staticLayerFBO);
+	}
+
+	// depth texture array for the lighting pass
+	unsigned int texture() const
+	{
+		return depthMap;
+	}
+
+	// GL_DEPTH_COMPONENT16, GL_DEPTH_COMPONENT24 or GL_DEPTH_COMPONENT32F
+	GLenum getDepthFormat() const
+	{
+		return depthFormat;
+	}
+
+	// recreates the depth textures with another storage format, all cascades are rendered again
+	void setDepthFormat(GLenum format)
+	{
+		if (format == depthFormat)
+			return;
+		release();
+		depthFormat = format;
+		createTarget(depthMap, depthMapFBO, layerFBO);
+		staticDirty = allCascades();
+		overlayActive = false;
+	}
+
+	// fits the cascades due this frame to the camera frustum, marks every cascade whose matrix changed
+	void fit(const glm::mat4& view, float fovy, float aspect, float zNear, float zFar, const glm::vec3& lightDir)
+	{
+		// practical split scheme: mix of logarithmic and uniform distribution
+		float distances[MAX_CASCADES + 1];
+		distances[0] = zNear;
+		for (int c = 1; c <= cascadeCount; c++)
+		{
+			float f = (float)c / cascadeCount;
+			float logSplit = zNear * std::pow(zFar / zNear, f);
+			float uniformSplit = zNear + (zFar - zNear) * f;
+			distances[c] = splitLambda * logSplit + (1.0f - splitLambda) * uniformSplit;
+		}
+
+		// light space rotation, the same for all cascades
+		glm::vec3 up = std::abs(lightDir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), lightDir, up);
+		glm::mat4 inverseView = glm::inverse(view);
+
+		unsigned long long interval = (unsigned long long)std::max(1, refreshInterval);
+		for (int c = 0; c < cascadeCount; c++)
+		{
+			bool due = c < firstDistantCascade || frame % interval == (unsigned long long)c % interval || splits[c] == 0.0f;
+			if (!due)
+				continue;
+
+			// bounding sphere of the slice corners, computed in view space so the radius doesn't depend on the rotation
+			glm::mat4 toView = glm::inverse(glm::perspective(fovy, aspect, distances[c], distances[c + 1]));
+			glm::vec3 corners[8];
+			glm::vec3 center(0.0f);
+			for (int i = 0; i < 8; i++)
+			{
+				glm::vec4 corner = toView * glm::vec4((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f, 1.0f);
+				corners[i] = glm::vec3(corner / corner.w);
+				center += corners[i] / 8.0f;
+			}
+			float radius = 0.0f;
+			for (int i = 0; i < 8; i++)
+				radius = std::max(radius, glm::length(corners[i] - center));
+			// rounded up so rounding noise never changes the texel size
+			radius = std::ceil(radius * 16.0f) / 16.0f;
+
+			// constant extent of 2 * radius, the origin snapped to whole texels of it
+			glm::vec3 lightCenter = glm::vec3(lightView * inverseView * glm::vec4(center, 1.0f));
+			float texelX = 2.0f * radius / width;
+			float texelY = 2.0f * radius / height;
+			lightCenter.x = std::floor(lightCenter.x / texelX) * texelX;
+			lightCenter.y = std::floor(lightCenter.y / texelY) * texelY;
+			glm::vec3 minimum = lightCenter - glm::vec3(radius);
+			glm::vec3 maximum = lightCenter + glm::vec3(radius);
+
+			// light looks down -z, casters between the light and the slice are on the side of maximum.z
+			glm::mat4 lightProjection = glm::ortho(minimum.x, maximum.x, minimum.y, maximum.y, -maximum.z - casterDistance, -minimum.z);
+			glm::mat4 matrix = lightProjection * lightView;
+			if (matrix != lightSpaceMatrices[c])
+			{
+				lightSpaceMatrices[c] = matrix;
+				staticDirty |= 1 << c;
+			}
+			splits[c] = distances[c + 1];
+			dueMask |= 1 << c;
+		}
+		frame++;
+	}
+
+	// light space matrix a cascade was rendered with
+	const glm::mat4& getLightSpaceMatrix(int cascade) const
+	{
+		return lightSpaceMatrices[cascade];
+	}
+
+	// far distance of a cascade along the view direction
+	float getSplit(int cascade) const
+	{
+		return splits[cascade];
+	}
+
+
+	// a static caster was added, removed or moved
+	void invalidateStatic()
+	{
+		staticDirty = allCascades();
+	}
+
+	// the dynamic casters moved
+	void invalidateDynamic()
+	{
+		dynamicDirty = true;
+	}
+
+	// true if update() would render anything
+	bool needsUpdate(bool hasDynamic) const
+	{
+		return renderMask(hasDynamic) != 0;
+	}
+
+	// re-renders the cascades that are out of date with depthShader, drawStatic/drawDynamic draw the casters.
+	// depthShader reads the cascade matrices from the Frame uniform block, upload them after fit().
+	// Leaves the default framebuffer bound, the caller has to reset the viewport if true is returned.
+	template <typename DrawStatic, typename DrawDynamic>
+	bool update(Shader& depthShader, bool hasDynamic, DrawStatic drawStatic, DrawDynamic drawDynamic)
+	{
+		int mask = renderMask(hasDynamic);
+		dueMask = 0;
+		if (mask == 0)
+		{
+			skippedUpdates++;
+			return false;
+		}
+
+		depthShader.use();
+		glState().viewport(0, 0, width, height);
+		glState().cullFace(GL_FRONT);
+		if (!hasDynamic)
+		{
+			// everything is static, render directly into the depth map
+			clearLayers(layerFBO, mask);
+			glState().bindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
+			depthShader.setInt("cascadeMask"_uniform, mask);
+			drawStatic();
+		}
+		else
+		{
+			int staticMask = overlayActive ? staticDirty : allCascades();
+			if (staticMask)
+			{
+				if (staticFBO == 0)
+					createTarget(staticDepth, staticFBO, staticLayerFBO);
+				clearLayers(staticLayerFBO, staticMask);
+				glState().bindFramebuffer(GL_FRAMEBUFFER, staticFBO);
+				depthShader.setInt("cascadeMask"_uniform, staticMask);
+				drawStatic();
+			}
+			// static cache as the starting point, dynamic casters on top
+			for (int c = 0; c < cascadeCount; c++)
+			{
+				if (!(mask & (1 << c)))
+					continue;
+				glState().bindFramebuffer(GL_READ_FRAMEBUFFER, staticLayerFBO[c]);
+				glState().bindFramebuffer(GL_DRAW_FRAMEBUFFER, layerFBO[c]);
+				glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+			}
+			glState().bindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
+			depthShader.setInt("cascadeMask"_uniform, mask);
+			drawDynamic();
+			dynamicDirty = false;
+		}
+		glState().cullFace(GL_BACK);
+		glState().bindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		staticDirty = 0;
+		overlayActive = hasDynamic;
+		renderedUpdates++;
+		for (int c = 0; c < cascadeCount; c++)
+			if (mask & (1 << c))
+				renderedCascades++;
+		return true;
+	}
+
+	// number of update() calls that rendered / were skipped, and cascades rendered in total
+	unsigned long long renderedUpdates = 0;
+	unsigned long long skippedUpdates = 0;
+	unsigned long long renderedCascades = 0;
+
+private:
+	int allCascades() const
+	{
+		return (1 << cascadeCount) - 1;
+	}
+
+	// cascades that have to be rendered this frame
+	int renderMask(bool hasDynamic) const
+	{
+		if (hasDynamic != overlayActive)
+			return allCascades();
+		int mask = staticDirty;
+		// moving casters are only redrawn into cascades that are due, distant ones follow on their schedule
+		if (hasDynamic && dynamicDirty)
+			mask |= dueMask;
+		return mask;
+	}
+
+	void clearLayers(const unsigned int fbos[], int mask)
+	{
+		for (int c = 0; c < cascadeCount; c++)
+		{
+			if (!(mask & (1 << c)))
+				continue;
+			glState().bindFramebuffer(GL_FRAMEBUFFER, fbos[c]);
+			glClear(GL_DEPTH_BUFFER_BIT);
+		}
+	}
+
+	void createTarget(unsigned int& texture, unsigned int& fbo, unsigned int layers[])
+	{
+		// create depth texture array, one layer per cascade
+		glGenTextures(1, &texture);
+		glState().bindTexture(GL_TEXTURE_2D_ARRAY, texture);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, depthFormat, width, height, cascadeCount, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+		// hardware depth compare, linear filtering blends the results of the 4 nearest texels
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+		float borderColor[] = { 1.0, 1.0, 1.0, 1.0 };
+		glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
+		// layered FBO, the geometry shader picks the cascade with gl_Layer
+		glGenFramebuffers(1, &fbo);
+		glState().bindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0);
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+		// one FBO per layer for clearing and copying single cascades
+		glGenFramebuffers(cascadeCount, layers);
+		for (int c = 0; c < cascadeCount; c++)
+		{
+			glState().bindFramebuffer(GL_FRAMEBUFFER, layers[c]);
+			glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, c);
+			glDrawBuffer(GL_NONE);
+			glReadBuffer(GL_NONE);
+		}
+		glState().bindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	void releaseTarget(unsigned int& texture, unsigned int& fbo, unsigned int layers[])
+	{
+		for (int c = 0; c < cascadeCount; c++)
+			glState().forgetFramebuffer(layers[c]);
+		glState().forgetFramebuffer(fbo);
+		glState().forgetTexture(texture);
+		glDeleteFramebuffers(cascadeCount, layers);
+		glDeleteFramebuffers(1, &fbo);
+		glDeleteTextures(1, &texture);
+		texture = fbo = 0;
+	}
+
+	GLenum depthFormat;
+	unsigned int depthMap = 0, depthMapFBO = 0;
+	unsigned int layerFBO[MAX_CASCADES] = {};
+	// static casters only, created when the first dynamic caster shows up
+	unsigned int staticDepth = 0, staticFBO = 0;
+	unsigned int staticLayerFBO[MAX_CASCADES] = {};
+	glm::mat4 lightSpaceMatrices[MAX_CASCADES];
+	float splits[MAX_CASCADES];
+	unsigned long long frame = 0;
+	// one bit per cascade
+	int staticDirty = 0;
+	int dueMask = 0;
+	bool dynamicDirty = true;
+	// depth map currently holds the static cache plus dynamic casters
+	bool overlayActive = false;
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef SPLINE_H
+#define SPLINE_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+//calculate tangents p1 and p2 as helper values
+//tcb1/tcb2 hold tension, bias and continuity of the keys p1 and p2
+inline void calcTangents(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2, glm::vec3 p3, glm::vec3& tang1, glm::vec3& tang2,
+	glm::vec3 tcb1 = glm::vec3(0.0f), glm::vec3 tcb2 = glm::vec3(0.0f)) {
+	float t = tcb1.x;
+	float b = tcb1.y;
+	float c = tcb1.z;
+
+	float coef1 = ((1 - t) * (1 + b) * (1 + c)) / 2;
+	float coef2 = ((1 - t) * (1 - b) * (1 - c)) / 2;
+
+	t = tcb2.x;
+	b = tcb2.y;
+	c = tcb2.z;
+
+	float coef3 = ((1 - t) * (1 + b) * (1 - c)) / 2;
+	float coef4 = ((1 - t) * (1 - b) * (1 + c)) / 2;
+
+	tang1 = coef1 * (p1 - p0) + coef2 * (p2 - p1);
+	tang2 = coef3 * (p2 - p1) + coef4 * (p3 - p2);
+}
+
+//same as above, returned in a vector
+inline std::vector<glm::vec3> calcTangents(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2, glm::vec3 p3) {
+	std::vector<glm::vec3> results(2);
+	calcTangents(p0, p1, p2, p3, results[0], results[1]);
+	return results;
+}
+
+//calculate the point between p0 and p1 based on the t value
+inline glm::vec3 calcPoint(float t, glm::vec3 p0, glm::vec3 p1, glm::vec3 tang1, glm::vec3 tang2) {
+	float t2 = t * t;
+	float t3 = t * t * t;
+
+	float h00 = 2 * t3 - 3 * t2 + 1;
+	float h10 = t3 - 2 * t2 + t;
+	float h01 = -2 * t3 + 3 * t2;
+	float h11 = t3 - t2;
+
+	return h00 * p0 + h10 * tang1 + h01 * p1 + h11 * tang2;
+}
+
+#endif
@@ -0,0 +1,271 @@
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+#include "DdsFile.h"
+#include "MappedFile.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// One packed file with every texture ready to upload, mapped with MappedFile so the loader hands the level data
+// straight from the mapping to glTexImage2D / glCompressedTexImage2D, no decoding, no copies on our side.
+// Layout: header, entry table (one entry per texture with its mip table), then the payloads (the mip chain, raw or
+// block compressed), each starting on a 4K page. An entry is keyed by image path and mip mode and stays valid while
+// the image (and the DDS file next to it, if any) keep their size and modification time. If only the time changed
+// (e.g. after a checkout) the content hash decides, and the entry gets the new time with the next save().
+
+namespace texcache
+{
+	const uint32_t MAGIC = 0x48435854; // "TXCH"
+	const uint32_t VERSION = 1;
+	const uint64_t ALIGNMENT = 4096;
+	const int MAX_LEVELS = 16;
+	// format of an entry that holds 8 bit texels instead of a BlockFormat
+	const int32_t UNCOMPRESSED = -1;
+
+	struct Header
+	{
+		uint32_t magic, version;
+		uint32_t count, reserved;
+	};
+
+	// size, modification time and FNV-1a hash of a source file, all 0 if it doesn't exist
+	struct Source
+	{
+		uint64_t size;
+		int64_t time;
+		uint64_t hash;
+	};
+
+	struct Entry
+	{
+		uint64_t key;
+		Source image, dds;
+		int32_t format, components, width, height, levels, reserved;
+		// payload position in the file, level offsets are relative to it
+		uint64_t offset, size;
+		uint64_t levelOffset[MAX_LEVELS];
+		uint64_t levelSize[MAX_LEVELS];
+	};
+
+	inline uint64_t fnv1a(const unsigned char* data, size_t size, uint64_t hash = 14695981039346656037ull)
+	{
+		for (size_t i = 0; i < size; i++)
+			hash = (hash ^ data[i]) * 1099511628211ull;
+		return hash;
+	}
+
+	inline uint64_t key(const std::string& path, int mode)
+	{
+		uint64_t hash = fnv1a((const unsigned char*)path.data(), path.size());
+		return fnv1a((const unsigned char*)&mode, sizeof(mode), hash);
+	}
+
+	inline uint64_t hashFile(const std::string& path)
+	{
+		MappedFile file;
+		return file.open(path.c_str()) ? fnv1a(file.data(), file.size()) : 0;
+	}
+
+	// withHash reads the whole file, only needed when an entry is written
+	inline Source source(const std::string& path, bool withHash)
+	{
+		Source result = {};
+		struct stat info;
+		if (stat(path.c_str(), &info) != 0)
+			return result;
+		result.size = (uint64_t)info.st_size;
+		result.time = (int64_t)info.st_mtime;
+		if (withHash)
+			result.hash = hashFile(path);
+		return result;
+	}
+
+	// the file at path is still the one the entry was made from, current gets its size, time and (the stored) hash
+	inline bool unchanged(const Source& stored, const std::string& path, Source& current)
+	{
+		current = source(path, false);
+		current.hash = stored.hash;
+		if (current.size != stored.size)
+			return false;
+		return current.time == stored.time || hashFile(path) == stored.hash;
+	}
+}
+
+class TextureCache
+{
+public:
+	// an entry to write: the entry fields (key, sources, format, size, levels) and the payload
+	struct Record
+	{
+		texcache::Entry entry;
+		const uint8_t* data;
+	};
+
+	// maps the cache file, false if it doesn't exist or isn't a valid cache
+	bool open(const std::string& path)
+	{
+		close();
+		filePath = path;
+		if (!file.open(path.c_str()))
+			return false;
+		const texcache::Header* header = (const texcache::Header*)file.data();
+		if (file.size() < sizeof(texcache::Header) || header->magic != texcache::MAGIC || header->version != texcache::VERSION
+			|| file.size() < sizeof(texcache::Header) + (uint64_t)header->count * sizeof(texcache::Entry))
+		{
+			file.close();
+			return false;
+		}
+		const texcache::Entry* table = (const texcache::Entry*)(header + 1);
+		for (uint32_t i = 0; i < header->count; i++)
+		{
+			if (valid(table[i], file.size()))
+				entries[table[i].key] = &table[i];
+		}
+		return true;
+	}
+
+	void close()
+	{
+		entries.clear();
+		file.close();
+		std::lock_guard<std::mutex> lock(restampMutex);
+		restamps.clear();
+	}
+
+	// the valid entry of the image, nullptr if there is none or a source changed. Safe to call from several threads.
+	const texcache::Entry* find(const std::string& path, const std::string& dds, int mode) const
+	{
+		auto it = entries.find(texcache::key(path, mode));
+		texcache::Source image, ddsSource;
+		if (it == entries.end() || !texcache::unchanged(it->second->image, path, image) || !texcache::unchanged(it->second->dds, dds, ddsSource))
+			return nullptr;
+		// only the time changed, keep the new one so the file isn't hashed again on every start
+		if (image.time != it->second->image.time || ddsSource.time != it->second->dds.time)
+		{
+			std::lock_guard<std::mutex> lock(restampMutex);
+			restamps[it->first] = { image, ddsSource };
+		}
+		return it->second;
+	}
+
+	// find() accepted an entry whose sources have a new time, the next save() writes it
+	bool restampPending() const
+	{
+		std::lock_guard<std::mutex> lock(restampMutex);
+		return !restamps.empty();
+	}
+
+	const uint8_t* payload(const texcache::Entry& entry) const
+	{
+		return file.data() + entry.offset;
+	}
+
+	// rewrites the cache with the given records and every old entry they don't replace, then maps the new file.
+	// The old mapping (and every payload pointer into it) is invalid afterwards.
+	bool save(std::vector<Record> records)
+	{
+		for (auto& old : entries)
+		{
+			bool replaced = std::any_of(records.begin(), records.end(), [&](const Record& r) { return r.entry.key == old.first; });
+			if (replaced)
+				continue;
+			records.push_back({ *old.second, payload(*old.second) });
+			std::lock_guard<std::mutex> lock(restampMutex);
+			auto restamp = restamps.find(old.first);
+			if (restamp != restamps.end())
+			{
+				records.back().entry.image = restamp->second.first;
+				records.back().entry.dds = restamp->second.second;
+			}
+		}
+		std::string temporary = filePath + ".tmp";
+		bool ok = write(temporary, records);
+		// the mapping has to go before the file can be replaced (on Windows)
+		close();
+		if (ok)
+		{
+			std::remove(filePath.c_str());
+			ok = std::rename(temporary.c_str(), filePath.c_str()) == 0;
+		}
+		if (!ok)
+			std::remove(temporary.c_str());
+		open(filePath);
+		return ok;
+	}
+
+	const std::string& path() const
+	{
+		return filePath;
+	}
+
+private:
+	// the payload lies in the file and the mip table matches what format, size and level count need
+	static bool valid(const texcache::Entry& entry, uint64_t fileSize)
+	{
+		if (entry.levels < 1 || entry.levels > texcache::MAX_LEVELS || entry.width < 1 || entry.height < 1
+			|| entry.width > (int)dds::MAX_SIZE || entry.height > (int)dds::MAX_SIZE
+			|| (std::max(entry.width, entry.height) >> (entry.levels - 1)) == 0)
+			return false;
+		bool compressed = entry.format != texcache::UNCOMPRESSED;
+		if (compressed ? entry.format < FORMAT_BC1 || entry.format > FORMAT_BC5 : entry.components < 1 || entry.components > 4)
+			return false;
+		if (entry.offset > fileSize || entry.size > fileSize - entry.offset)
+			return false;
+		for (int level = 0; level < entry.levels; level++)
+		{
+			int width = std::max(1, entry.width >> level), height = std::max(1, entry.height >> level);
+			uint64_t expected = compressed ? CompressedImage::levelBytes((BlockFormat)entry.format, width, height)
+				: (uint64_t)width * height * entry.components;
+			if (entry.levelSize[level] != expected || entry.levelOffset[level] > entry.size
+				|| entry.levelSize[level] > entry.size - entry.levelOffset[level])
+				return false;
+		}
+		return true;
+	}
+
+	static bool write(const std::string& path, std::vector<Record>& records)
+	{
+		texcache::Header header = { texcache::MAGIC, texcache::VERSION, (uint32_t)records.size(), 0 };
+		uint64_t offset = sizeof(header) + records.size() * sizeof(texcache::Entry);
+		for (Record& record : records)
+		{
+			offset = (offset + texcache::ALIGNMENT - 1) / texcache::ALIGNMENT * texcache::ALIGNMENT;
+			record.entry.offset = offset;
+			offset += record.entry.size;
+		}
+
+		FILE* out = std::fopen(path.c_str(), "wb");
+		if (out == nullptr)
+			return false;
+		bool ok = std::fwrite(&header, sizeof(header), 1, out) == 1;
+		for (const Record& record : records)
+			ok = ok && std::fwrite(&record.entry, sizeof(texcache::Entry), 1, out) == 1;
+		uint64_t position = sizeof(header) + records.size() * sizeof(texcache::Entry);
+		static const char zeros[texcache::ALIGNMENT] = {};
+		for (const Record& record : records)
+		{
+			ok = ok && std::fwrite(zeros, 1, (size_t)(record.entry.offset - position), out) == record.entry.offset - position;
+			ok = ok && std::fwrite(record.data, 1, (size_t)record.entry.size, out) == record.entry.size;
+			position = record.entry.offset + record.entry.size;
+		}
+		return std::fclose(out) == 0 && ok;
+	}
+
+	std::string filePath;
+	MappedFile file;
+	std::unordered_map<uint64_t, const texcache::Entry*> entries;
+	// new image and DDS sources of entries find() accepted by their hash
+	mutable std::mutex restampMutex;
+	mutable std::unordered_map<uint64_t, std::pair<texcache::Source, texcache::Source>> restamps;
+};
+
+#endif
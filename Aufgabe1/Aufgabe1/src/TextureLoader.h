@@ -0,0 +1,620 @@
+#ifndef TEXTURELOADER_H
+#define TEXTURELOADER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "GLState.h"
+#include "DdsFile.h"
+#include "MipGenerator.h"
+#include "TextureCache.h"
+#include "stb_image.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// EXT_texture_compression_s3tc, not part of core 3.3 but supported by every desktop driver
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// Loads textures in the background: load() returns the texture name right away, the texture holds a 1x1
+// placeholder color until the real image is resident, so it can be put into materials immediately.
+// Decoding (stbi_load) runs on a pool of worker threads, update() on the GL thread uploads at most
+// uploadsPerFrame decoded images per call through a ring of pixel unpack buffers. A ring slot is reused once
+// the fence of its last upload has passed, so filling it never waits for the GPU.
+// If a DDS file made by the TextureTool lies next to the image (same name, extension .dds) it is used instead:
+// no decoding, the block compressed mip chain is uploaded as it is with glCompressedTexImage2D.
+// Otherwise the workers build the mip chain with the MipGenerator (normal maps renormalized, color gamma correct).
+// With a cache file every texture that had to be decoded is packed into it (TextureCache.h) once all pending
+// textures are loaded. On later starts the workers only check the entry and touch its pages, the GL thread
+// uploads straight from the mapping.
+// loadLayer() fills one layer of an array texture instead (MaterialLibrary.h), the image has to have the size and
+// the array's format: uncompressed arrays take decoded images, block compressed arrays only DDS files.
+class TextureLoader
+{
+public:
+	static const int PBO_RING = 3;
+
+	// threads 0 uses all cores but one, an empty cache path disables the cache
+	explicit TextureLoader(const std::string& cachePath = "", int threads = 0, int uploadsPerFrame = 2)
+		: uploadsPerFrame(uploadsPerFrame), caching(!cachePath.empty())
+	{
+		if (caching)
+			cache.open(cachePath);
+		GLint extensions = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &extensions);
+		for (GLint i = 0; i < extensions; i++)
+			if (std::string((const char*)glGetStringi(GL_EXTENSIONS, i)) == "GL_EXT_texture_compression_s3tc")
+				s3tc = true;
+		int cores = std::max(1, (int)std::thread::hardware_concurrency());
+		if (threads <= 0)
+			threads = std::max(1, cores - 1);
+		// cores the workers leave idle help with the rows of a level
+		mipThreads = std::max(1, cores / threads);
+		for (int i = 0; i < threads; i++)
+			workers.emplace_back(&TextureLoader::decodeLoop, this);
+		for (Slot& slot : slots)
+			glGenBuffers(1, &slot.pbo);
+	}
+
+	// stops the workers and frees the buffers, has to be called while the context is still alive
+	void release()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+			jobs.clear();
+		}
+		jobAdded.notify_all();
+		for (std::thread& worker : workers)
+			worker.join();
+		workers.clear();
+		decoded.clear();
+		uncached.clear();
+		cache.close();
+		for (Slot& slot : slots)
+		{
+			if (slot.fence)
+				glDeleteSync(slot.fence);
+			glDeleteBuffers(1, &slot.pbo);
+			slot = Slot();
+		}
+	}
+
+	// texture with the placeholder color (0-1) until the image at path is loaded, mode MIP_NORMAL for normal maps
+	GLuint load(const std::string& path, const glm::vec3& placeholder = glm::vec3(0.5f), MipMode mode = MIP_COLOR)
+	{
+		GLuint texture;
+		glGenTextures(1, &texture);
+		unsigned char color[3] = { (unsigned char)(placeholder.r * 255.0f), (unsigned char)(placeholder.g * 255.0f), (unsigned char)(placeholder.b * 255.0f) };
+		glState().bindTexture(GL_TEXTURE_2D, texture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, color);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		// no mipmaps yet
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		queue({ texture, path, mode, -1, 0, 0, texcache::UNCOMPRESSED, placeholder });
+		return texture;
+	}
+
+	// loads the image into a layer of a GL_TEXTURE_2D_ARRAY of width x height with a full mip chain, format is the
+	// BlockFormat of the array or texcache::UNCOMPRESSED for RGB8. The array should be sampled from a placeholder
+	// base level until then, once every queued layer is in its base level is set back to 0. A layer that fails to
+	// load is filled with the placeholder color.
+	void loadLayer(GLuint array, int layer, int width, int height, const std::string& path, const glm::vec3& placeholder = glm::vec3(0.5f),
+		MipMode mode = MIP_COLOR, int32_t format = texcache::UNCOMPRESSED)
+	{
+		queue({ array, path, mode, layer, width, height, format, placeholder });
+	}
+
+	// the driver can sample textures of this block format
+	bool supports(BlockFormat format) const
+	{
+		return format == FORMAT_BC5 || s3tc;
+	}
+
+	// the DDS file the TextureTool makes for the image at path
+	static std::string ddsPath(const std::string& path)
+	{
+		return path.substr(0, path.find_last_of('.')) + ".dds";
+	}
+
+	static GLenum compressedFormat(BlockFormat format)
+	{
+		return format == FORMAT_BC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+			: format == FORMAT_BC3 ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RG_RGTC2;
+	}
+
+	// fills a level of a layer of the bound array texture with a solid color, as RGB8 texels or as blocks of the
+	// format (both endpoints the color, every index 0)
+	static void fillLevel(int layer, int level, int width, int height, int32_t format, const glm::vec3& color)
+	{
+		uint8_t r = (uint8_t)(color.r * 255.0f), g = (uint8_t)(color.g * 255.0f), b = (uint8_t)(color.b * 255.0f);
+		std::vector<uint8_t> data;
+		if (format == texcache::UNCOMPRESSED)
+		{
+			data.resize((size_t)width * height * 3);
+			for (size_t i = 0; i < data.size(); i += 3)
+			{
+				data[i] = r;
+				data[i + 1] = g;
+				data[i + 2] = b;
+			}
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			texImage(layer, level, width, height, 3, data.data());
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			return;
+		}
+		BlockFormat blockFormat = (BlockFormat)format;
+		uint8_t block[16] = {};
+		if (blockFormat == FORMAT_BC5)
+		{
+			block[0] = block[1] = r;
+			block[8] = block[9] = g;
+		}
+		else
+		{
+			// BC3 starts with an alpha block, opaque
+			int color = blockFormat == FORMAT_BC3 ? 8 : 0;
+			if (blockFormat == FORMAT_BC3)
+				block[0] = block[1] = 255;
+			uint16_t rgb565 = (uint16_t)((r >> 3) << 11 | (g >> 2) << 5 | (b >> 3));
+			block[color] = block[color + 2] = (uint8_t)(rgb565 & 0xFF);
+			block[color + 1] = block[color + 3] = (uint8_t)(rgb565 >> 8);
+		}
+		size_t blockBytes = CompressedImage::blockBytes(blockFormat);
+		data.resize(CompressedImage::levelBytes(blockFormat, width, height));
+		for (size_t i = 0; i < data.size(); i += blockBytes)
+			std::memcpy(&data[i], block, blockBytes);
+		compressedImage(layer, level, compressedFormat(blockFormat), width, height, (GLsizei)data.size(), data.data());
+	}
+
+	// uploads decoded images, call once per frame
+	void update()
+	{
+		uploadDecoded(uploadsPerFrame, false);
+		saveCache();
+	}
+
+	// the image is uploaded (or failed to load, then the placeholder stays), for arrays all of its layers
+	bool ready(GLuint texture) const
+	{
+		auto it = pendingUploads.find(texture);
+		return it == pendingUploads.end() || it->second == 0;
+	}
+
+	// textures that still show their placeholder
+	int pending() const
+	{
+		return pendingCount;
+	}
+
+	// blocks until the texture is uploaded, other textures decoded in the meantime are uploaded as well
+	void wait(GLuint texture)
+	{
+		while (!ready(texture))
+			waitForDecoded();
+	}
+
+	void waitAll()
+	{
+		while (pendingCount > 0)
+			waitForDecoded();
+	}
+
+private:
+	struct Job
+	{
+		GLuint texture;
+		std::string path;
+		MipMode mode;
+		// layer of an array texture and its size, -1 for a texture of its own
+		int layer, width, height;
+		// format of the array
+		int32_t format;
+		glm::vec3 placeholder;
+	};
+
+	void queue(const Job& job)
+	{
+		pendingUploads[job.texture]++;
+		pendingCount++;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.push_back(job);
+		}
+		jobAdded.notify_one();
+	}
+
+	struct Image
+	{
+		Job job;
+		// entry in the cache, the data is uploaded from the mapping then and everything else is empty
+		const texcache::Entry* cached;
+		// the files the image was decoded from, for its new cache entry
+		texcache::Source imageSource, ddsSource;
+		// no levels if the image failed to load
+		MipChain mips;
+		// from the DDS file, mips is empty then
+		bool compressed;
+		CompressedImage blocks;
+	};
+
+	struct Slot
+	{
+		GLuint pbo = 0;
+		GLsizeiptr size = 0;
+		GLsync fence = 0;
+	};
+
+	void decodeLoop()
+	{
+		for (;;)
+		{
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				jobAdded.wait(lock, [this]() { return stopping || !jobs.empty(); });
+				if (stopping)
+					return;
+				job = jobs.front();
+				jobs.pop_front();
+			}
+			Image image = { job, nullptr, {}, {}, MipChain(), false, CompressedImage() };
+			std::string dds = ddsPath(job.path);
+			const texcache::Entry* entry = cache.find(job.path, dds, job.mode);
+			// layers take only the format of their array, textures of their own any format the driver can sample
+			bool usable = entry != nullptr && (job.layer >= 0 ? entry->format == job.format
+				: entry->format == texcache::UNCOMPRESSED || supports((BlockFormat)entry->format));
+			if (usable)
+			{
+				image.cached = entry;
+				prefetch(cache.payload(*entry), entry->size);
+			}
+			else
+			{
+				if (caching)
+				{
+					image.imageSource = texcache::source(job.path, true);
+					image.ddsSource = texcache::source(dds, true);
+				}
+				bool blocks = job.layer < 0 || job.format != texcache::UNCOMPRESSED;
+				image.compressed = blocks && readDds(dds, image.blocks)
+					&& (job.layer < 0 ? supports(image.blocks.format) : image.blocks.format == job.format);
+			}
+			// block compressed arrays can't take decoded images
+			if (image.cached == nullptr && !image.compressed && (job.layer < 0 || job.format == texcache::UNCOMPRESSED))
+			{
+				int width, height, components;
+				unsigned char* data = stbi_load(job.path.c_str(), &width, &height, &components, 0);
+				if (data != nullptr)
+				{
+					// textures with alpha are clamped (see setParameters), the rest wraps around
+					image.mips = generateMips(data, width, height, components, job.mode, MIP_FILTER, components != 4, mipThreads);
+					stbi_image_free(data);
+				}
+			}
+			if (job.layer >= 0)
+			{
+				int width = image.cached ? image.cached->width : image.compressed ? image.blocks.width : image.mips.width;
+				int height = image.cached ? image.cached->height : image.compressed ? image.blocks.height : image.mips.height;
+				int levels = image.cached ? image.cached->levels : image.compressed ? image.blocks.levels : image.mips.levels;
+				int arrayLevels = 1;
+				while ((std::max(job.width, job.height) >> arrayLevels) > 0)
+					arrayLevels++;
+				if (levels > 0 && (width != job.width || height != job.height || levels != arrayLevels))
+				{
+					std::cout << "ERROR::TEXTURE::LAYER_SIZE " << job.path << " is " << width << "x" << height << " with " << levels
+						<< " levels, the array " << job.width << "x" << job.height << " with " << arrayLevels << std::endl;
+					image.cached = nullptr;
+					image.compressed = false;
+					image.blocks = CompressedImage();
+					image.mips = MipChain();
+				}
+			}
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				decoded.push_back(std::move(image));
+			}
+			imageDecoded.notify_one();
+		}
+	}
+
+	void waitForDecoded()
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			imageDecoded.wait(lock, [this]() { return !decoded.empty(); });
+		}
+		uploadDecoded(PBO_RING, true);
+		saveCache();
+	}
+
+	// reads one byte per page, the page faults of a cold cache happen on the worker instead of in glTexImage2D
+	static void prefetch(const uint8_t* data, uint64_t size)
+	{
+		uint8_t sum = 0;
+		for (uint64_t i = 0; i < size; i += texcache::ALIGNMENT)
+			sum += data[i];
+		volatile uint8_t sink = sum;
+		(void)sink;
+	}
+
+	// uploads up to count decoded images, without block it stops at a ring slot the GPU still reads from
+	void uploadDecoded(int count, bool block)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			bool mapped;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (decoded.empty())
+					return;
+				mapped = decoded.front().cached != nullptr;
+			}
+			// images from the cache don't go through the ring
+			Slot& slot = slots[nextSlot];
+			if (!mapped && slot.fence)
+			{
+				GLenum status = glClientWaitSync(slot.fence, block ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, block ? 1000000000ull : 0);
+				if (status == GL_TIMEOUT_EXPIRED)
+					return;
+				glDeleteSync(slot.fence);
+				slot.fence = 0;
+			}
+
+			Image image;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				image = std::move(decoded.front());
+				decoded.pop_front();
+			}
+			const Job& job = image.job;
+			pendingUploads[job.texture]--;
+			pendingCount--;
+			if (image.cached)
+			{
+				uploadMapped(job.texture, job.layer, *image.cached, cache.payload(*image.cached));
+				layerLoaded(job);
+				continue;
+			}
+			if (image.compressed)
+			{
+				uploadCompressed(slot, job.texture, job.layer, image.blocks);
+			}
+			else if (image.mips.levels == 0)
+			{
+				std::cout << "Texture failed to load at path: " << job.path << std::endl;
+				if (job.layer >= 0)
+				{
+					glState().bindTexture(GL_TEXTURE_2D_ARRAY, job.texture);
+					for (int level = 0; (std::max(job.width, job.height) >> level) > 0; level++)
+						fillLevel(job.layer, level, std::max(1, job.width >> level), std::max(1, job.height >> level), job.format, job.placeholder);
+					layerLoaded(job);
+				}
+				continue;
+			}
+			else
+			{
+				upload(slot, job.texture, job.layer, image.mips);
+			}
+			layerLoaded(job);
+			nextSlot = (nextSlot + 1) % PBO_RING;
+			if (caching)
+				uncached.push_back(std::move(image));
+		}
+	}
+
+	// entry fields of a MipChain or CompressedImage, offset and sources are filled in by the caller
+	template <typename Chain>
+	static texcache::Entry describe(const Chain& chain, int32_t format, int32_t components)
+	{
+		texcache::Entry entry = {};
+		entry.format = format;
+		entry.components = components;
+		entry.width = chain.width;
+		entry.height = chain.height;
+		entry.levels = chain.levels;
+		entry.size = chain.data.size();
+		for (int level = 0; level < chain.levels && level < texcache::MAX_LEVELS; level++)
+		{
+			entry.levelOffset[level] = chain.levelOffset(level);
+			entry.levelSize[level] = chain.levelSize(level);
+		}
+		return entry;
+	}
+
+	// packs the newly decoded textures (and the new times of entries that were accepted by their hash) into the
+	// cache once nothing is pending anymore (no worker reads the mapping then, and no decoded image points into it)
+	void saveCache()
+	{
+		if (pendingCount > 0 || (uncached.empty() && !cache.restampPending()))
+			return;
+		std::vector<TextureCache::Record> records;
+		for (const Image& image : uncached)
+		{
+			texcache::Entry entry = image.compressed ? describe(image.blocks, image.blocks.format, 0)
+				: describe(image.mips, texcache::UNCOMPRESSED, image.mips.components);
+			if (entry.levels > texcache::MAX_LEVELS)
+				continue;
+			entry.key = texcache::key(image.job.path, image.job.mode);
+			entry.image = image.imageSource;
+			entry.dds = image.ddsSource;
+			records.push_back({ entry, image.compressed ? image.blocks.data.data() : image.mips.data.data() });
+		}
+		if (!cache.save(records))
+			std::cout << "Failed to write the texture cache " << cache.path() << std::endl;
+		uncached.clear();
+	}
+
+	static GLenum pixelFormat(int components)
+	{
+		return components == 1 ? GL_RED : components == 2 ? GL_RG : components == 3 ? GL_RGB : GL_RGBA;
+	}
+
+	// copies the data into the slot's buffer and leaves it bound, false if mapping failed (then the data is
+	// passed to GL directly and the buffer is unbound)
+	bool stage(Slot& slot, const void* data, GLsizeiptr size)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+		if (size > slot.size)
+		{
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+			slot.size = size;
+		}
+		void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		if (mapped == nullptr)
+		{
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			return false;
+		}
+		std::memcpy(mapped, data, size);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		return true;
+	}
+
+	// one level of a 2D texture or of a layer of an array texture (layer >= 0), the texture has to be bound
+	static void texImage(int layer, int level, int width, int height, int components, const void* pixels)
+	{
+		GLenum format = pixelFormat(components);
+		if (layer < 0)
+			glTexImage2D(GL_TEXTURE_2D, level, format, width, height, 0, format, GL_UNSIGNED_BYTE, pixels);
+		else
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, width, height, 1, format, GL_UNSIGNED_BYTE, pixels);
+	}
+
+	// the same for a block compressed level
+	static void compressedImage(int layer, int level, GLenum format, int width, int height, GLsizei size, const void* data)
+	{
+		if (layer < 0)
+			glCompressedTexImage2D(GL_TEXTURE_2D, level, format, width, height, 0, size, data);
+		else
+			glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, width, height, 1, format, size, data);
+	}
+
+	// once every queued layer of an array is in, it is sampled from level 0 again (see loadLayer)
+	void layerLoaded(const Job& job)
+	{
+		if (job.layer < 0 || pendingUploads[job.texture] > 0)
+			return;
+		glState().bindTexture(GL_TEXTURE_2D_ARRAY, job.texture);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+	}
+
+	// the whole chain in one buffer, one glTexImage2D per level
+	void upload(Slot& slot, GLuint texture, int layer, const MipChain& mips)
+	{
+		bool mapped = stage(slot, mips.data.data(), (GLsizeiptr)mips.data.size());
+
+		// rows of the levels are tightly packed
+		glState().bindTexture(layer < 0 ? GL_TEXTURE_2D : GL_TEXTURE_2D_ARRAY, texture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for (int level = 0; level < mips.levels; level++)
+		{
+			const uint8_t* offset = mapped ? nullptr : mips.data.data();
+			texImage(layer, level, mips.levelWidth(level), mips.levelHeight(level), mips.components, offset + mips.levelOffset(level));
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		// the parameters of an array belong to its owner
+		if (layer < 0)
+		{
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mips.levels - 1);
+			setParameters(mips.components == 4);
+		}
+	}
+
+	// all levels of the DDS file in one buffer, one glCompressedTexImage2D (or SubImage3D for a layer) per level
+	void uploadCompressed(Slot& slot, GLuint texture, int layer, const CompressedImage& blocks)
+	{
+		GLenum format = compressedFormat(blocks.format);
+		bool mapped = stage(slot, blocks.data.data(), (GLsizeiptr)blocks.data.size());
+		glState().bindTexture(layer < 0 ? GL_TEXTURE_2D : GL_TEXTURE_2D_ARRAY, texture);
+		for (int level = 0; level < blocks.levels; level++)
+		{
+			const uint8_t* offset = mapped ? nullptr : blocks.data.data();
+			compressedImage(layer, level, format, blocks.levelWidth(level), blocks.levelHeight(level),
+				(GLsizei)blocks.levelSize(level), offset + blocks.levelOffset(level));
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		if (layer < 0)
+		{
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, blocks.levels - 1);
+			setParameters(blocks.format == FORMAT_BC3);
+		}
+	}
+
+	// every level straight from the cache mapping with the entry's mip table, no buffer in between
+	void uploadMapped(GLuint texture, int layer, const texcache::Entry& entry, const uint8_t* payload)
+	{
+		bool compressed = entry.format != texcache::UNCOMPRESSED;
+		glState().bindTexture(layer < 0 ? GL_TEXTURE_2D : GL_TEXTURE_2D_ARRAY, texture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for (int level = 0; level < entry.levels; level++)
+		{
+			int width = std::max(1, entry.width >> level), height = std::max(1, entry.height >> level);
+			const uint8_t* pixels = payload + entry.levelOffset[level];
+			if (compressed)
+				compressedImage(layer, level, compressedFormat((BlockFormat)entry.format), width, height, (GLsizei)entry.levelSize[level], pixels);
+			else
+				texImage(layer, level, width, height, entry.components, pixels);
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		if (layer < 0)
+		{
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, entry.levels - 1);
+			setParameters(compressed ? entry.format == FORMAT_BC3 : entry.components == 4);
+		}
+	}
+
+	// textures with alpha are clamped, the rest repeats
+	void setParameters(bool alpha)
+	{
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, alpha ? GL_CLAMP_TO_EDGE : GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, alpha ? GL_CLAMP_TO_EDGE : GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+
+	static const MipFilter MIP_FILTER = FILTER_KAISER;
+
+	int uploadsPerFrame;
+	int mipThreads = 1;
+	std::vector<std::thread> workers;
+	Slot slots[PBO_RING];
+	int nextSlot = 0;
+	// uploads still to come per texture, several for the layers of an array
+	std::unordered_map<GLuint, int> pendingUploads;
+	int pendingCount = 0;
+	bool s3tc = false;
+	bool caching;
+	// decoded this run, packed into the cache by saveCache
+	std::vector<Image> uncached;
+
+	// shared with the workers
+	std::mutex mutex;
+	std::condition_variable jobAdded;
+	std::condition_variable imageDecoded;
+	std::deque<Job> jobs;
+	std::deque<Image> decoded;
+	bool stopping = false;
+	// only read by the workers, rewritten by saveCache while no job is pending
+	TextureCache cache;
+};
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef UNIFORMBUFFERS_H
+#define UNIFORMBUFFERS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "ShadowMap.h"
+
+// Uniform blocks shared by all programs, bound once to fixed binding points.
+// The structs follow the std140 layout of the blocks in shader.vs, shader.fs and depthShader.gs,
+// keep them in sync.
+
+const GLuint FRAME_BINDING = 0;
+const GLuint LIGHT_BINDING = 1;
+
+// everything that changes once per frame
+struct FrameUniforms
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::mat4 viewProjection;
+	// one per shadow cascade, near to far
+	glm::mat4 lightSpaceMatrices[MAX_CASCADES];
+	glm::vec4 viewPos;
+	int cascadeCount;
+	// PCF taps per fragment: 1, 4, 9 or 16
+	int shadowTaps;
+	float bumpiness;
+	float padding;
+};
+
+// the light, only uploaded when it changes
+struct LightUniforms
+{
+	glm::vec4 lightPos;
+	glm::vec4 lightColor;
+};
+
+// one uniform buffer holding a T, attached to a binding point for its whole lifetime
+template <typename T>
+class UniformBuffer
+{
+public:
+	T data;
+
+	UniformBuffer(GLuint bindingPoint)
+		: binding(bindingPoint)
+	{
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(T), NULL, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+	}
+
+	// write data into the buffer with a single call
+	void upload()
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(T), &data);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	// frees the buffer, has to be called while the context is still alive
+	void release()
+	{
+		glDeleteBuffers(1, &buffer);
+		buffer = 0;
+	}
+
+private:
+	GLuint binding;
+	unsigned int buffer = 0;
+};
+
+#endif
@@ -0,0 +1,36 @@
+#version 330 core
+#define MAX_CASCADES 4
+layout (triangles) in;
+layout (triangle_strip, max_vertices = 12) out;
+
+// shared with all programs, has to match FrameUniforms in UniformBuffers.h
+layout (std140) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    mat4 lightSpaceMatrices[MAX_CASCADES];
+    vec4 viewPos;
+    int cascadeCount;
+    int shadowTaps;
+    float bumpiness;
+};
+// bit per cascade that is rendered in this pass
+uniform int cascadeMask;
+
+void main()
+{
+    // one copy of the triangle per cascade layer
+    for (int c = 0; c < cascadeCount; ++c)
+    {
+        if ((cascadeMask & (1 << c)) == 0)
+            continue;
+        for (int i = 0; i < 3; ++i)
+        {
+            gl_Layer = c;
+            gl_Position = lightSpaceMatrices[c] * gl_in[i].gl_Position;
+            EmitVertex();
+        }
+        EndPrimitive();
+    }
+}
\ No newline at end of file
@@ -1,10 +1,9 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
-
-uniform mat4 lightSpaceMatrix;
-uniform mat4 model;
+layout (location = 4) in mat4 aModel;
 
 void main()
 {
-    gl_Position = lightSpaceMatrix * model * vec4(aPos, 1.0);
+    // world space, the geometry shader projects into every cascade
+    gl_Position = aModel * vec4(aPos, 1.0);
 }
\ No newline at end of file
@@ -1,6 +1,5 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
-#include "stb_image.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -11,39 +10,108 @@
 #include <glm/gtx/string_cast.hpp>
 
 #include "Shader.h"
+#include "CameraPath.h"
+#include "Clock.h"
+#include "PathFile.h"
+#include "ShadowMap.h"
+#include "ShadowBenchmark.h"
+#include "UniformBuffers.h"
+#include "RenderQueue.h"
+#include "Culling.h"
+#include "SceneGenerator.h"
+#include "FrameReport.h"
+#include "GpuProfiler.h"
+#include "CpuProfiler.h"
+#include "RenderTarget.h"
+#include "TextureLoader.h"
+#include "MaterialLibrary.h"
 
 #include <iostream>
 #include <vector>
 #include <algorithm> 
+#include <chrono>
+#include <fstream>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window);
-unsigned int loadTexture(const char* path);
 void restartScene();
-void renderCube();
-void renderScene(const Shader& shader, const glm::vec3 cubePos[]);
-
-// calculation functions
-int calcCorrectIndex(int index);
-std::vector<glm::vec3> calcTangents(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2, glm::vec3 p3);
-glm::vec3 calcPoint(float t, glm::vec3 p0, glm::vec3 p1, glm::vec3 tang1, glm::vec3 tang2);
+Mesh createCubeMesh();
+void buildRenderQueue(RenderQueue& queue, unsigned int program, const glm::mat4& view, bool shadows,
+	const std::vector<uint8_t>& cameraVisible, const std::vector<uint8_t>& casterVisible);
 
 // settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
+// camera projection
+const float FOV = glm::radians(45.0f);
+const float NEAR_PLANE = 0.1f;
+const float FAR_PLANE = 100.0f;
+// shadow cascades, the distant ones (from the third on) are only updated every CASCADE_REFRESH_INTERVAL frames
+const int SHADOW_CASCADES = 4;
+const int CASCADE_REFRESH_INTERVAL = 4;
+//shadow map storage and PCF taps per fragment (1, 4, 9 or 16), the taps can be changed with F1-F4
+GLenum shadowFormat = GL_DEPTH_COMPONENT24;
+int shadowTaps = 4;
+//time the lighting pass for every shadow format and kernel size, then exit
+bool shadowBenchmark = false;
 
-std::vector<glm::vec3> tangents;
 //num of points for camerapath
 const int CAMERPATHLENGTH = 20;
-//increment for T
+//increment for T, the camera covers this fraction of an average segment per frame at 60 fps
 float increment = 0.005f;
+//simulation runs in fixed steps of this size (seconds)
+const double SIMULATION_STEP = 1.0 / 120.0;
+float timeScale = 1.0f;
+//fixed time per frame for deterministic replays, 0 means real time
+float fixedFrameTime = 0.0f;
+//binary path file to play back instead of the built in path, and where to save the built in path
+std::string pathFile;
+std::string writePathTo;
 float bumpiness = 1.0f;
+//msaa samples of the render target (0, 2, 4 or 8), switched at runtime with the keys 1-4
 int samples = 4;
+//generated stress scene instead of the demo cubes: layout, number of cubes, seed and whether the camera flies a generated path
+SceneLayout sceneLayout = SCENE_DEMO;
+int sceneCount = 1000;
+unsigned int sceneSeed = 1;
+bool scenePath = false;
+//a cube circling over the scene as a dynamic shadow caster (F7 starts it, F8 stops it where it is), the shadow map
+//keeps the static casters cached and only redraws the moving one on top
+bool movingCaster = false;
+//render size, offscreen in headless mode: N frames (0 = one loop of the path) into an FBO, then a JSON report
+unsigned int renderWidth = SCR_WIDTH;
+unsigned int renderHeight = SCR_HEIGHT;
+bool headless = false;
+int headlessFrames = 0;
+std::string reportFile;
+//GPU time per pass as bars in the corner (F5 on, F6 off) and optionally every frame into a CSV file
+bool showGpuOverlay = false;
+std::string gpuProfileFile;
+//chrome trace of the cpu zones, needs a build with EZG_PROFILE
+std::string traceFile;
+//packed, memory mapped texture cache (TextureCache.h), empty = decode the images every start
+std::string textureCacheFile = "src/textures.cache";
 
 unsigned int planeVAO;
+unsigned int cubeVAO;
+unsigned int cubeVBO;
+
+// one object of the scene, turned into render queue packets every frame
+struct Renderable
+{
+	glm::mat4 model;
+	unsigned int mesh;
+	unsigned int material;
+	// static objects never move and are cached in the shadow map, dynamic ones are drawn over the cache
+	bool dynamic;
+};
+std::vector<Renderable> scene;
+// world space boxes of the scene objects, same order as scene: what the camera sees and what casts shadows
+Culler cameraBounds;
+Culler casterBounds;
 
 void printUsage() {
-	std::cerr << "Usage: Aufgabe1.exe --samples [sampling mode]" << std::endl;
+	std::cerr << "Usage: Aufgabe1.exe --samples [sampling mode] --timescale [factor] --fixed-dt [seconds per frame] --path [path file] --write-path [path file] --shadow-format [16|24|32f] --shadow-taps [1|4|9|16] --shadow-benchmark --scene [grid|clusters|towers] --scene-count [cubes] --scene-seed [seed] --scene-path --headless --width [pixels] --height [pixels] --frames [count] --report [json file] --gpu-profile [csv file] --trace [json file] --texture-cache [file|none] --moving-caster" << std::endl;
 }
 
 int main(int argc, char* argv[])
@@ -64,6 +132,149 @@ int main(int argc, char* argv[])
 				return 1;
 			}
 		}
+		if (std::string(argv[i]) == "--timescale") {
+			if (i + 1 < argc && std::stof(argv[i + 1]) >= 0) {
+				timeScale = std::stof(argv[i + 1]);
+			}
+			else {
+				printUsage();
+				return 1;
+			}
+		}
+		if (std::string(argv[i]) == "--fixed-dt") {
+			if (i + 1 < argc && std::stof(argv[i + 1]) > 0) {
+				fixedFrameTime = std::stof(argv[i + 1]);
+			}
+			else {
+				printUsage();
+				return 1;
+			}
+		}
+		if (std::string(argv[i]) == "--path" || std::string(argv[i]) == "--write-path") {
+			if (i + 1 < argc) {
+				(std::string(argv[i]) == "--path" ? pathFile : writePathTo) = argv[i + 1];
+			}
+			else {
+				printUsage();
+				return 1;
+			}
+		}
+		if (std::string(argv[i]) == "--shadow-format") {
+			std::string format = i + 1 < argc ? argv[i + 1] : "";
+			if (format == "16") {
+				shadowFormat = GL_DEPTH_COMPONENT16;
+			}
+			else if (format == "24") {
+				shadowFormat = GL_DEPTH_COMPONENT24;
+			}
+			else if (format == "32f") {
+				shadowFormat = GL_DEPTH_COMPONENT32F;
+			}
+			else {
+				printUsage();
+				return 1;
+			}
+		}
+		if (std::string(argv[i]) == "--shadow-taps") {
+			int taps = i + 1 < argc ? std::stoi(argv[i + 1]) : 0;
+			if (taps == 1 || taps == 4 || taps == 9 || taps == 16) {
+				shadowTaps = taps;
+			}
+			else {
+				printUsage();
+				return 1;
+			}
+		}
+		if (std::string(argv[i]) == "--shadow-benchmark") {
+			shadowBenchmark = true;
+		}
+		if (std::string(argv[i]) == "--scene") {
+			if (i + 1 >= argc || !parseSceneLayout(argv[i + 1], sceneLayout)) {
+				printUsage();
+				return 1;
+			}
+		}
+		if (std::string(argv[i]) == "--scene-count") {
+			if (i + 1 < argc && std::stoi(argv[i + 1]) > 0) {
+				sceneCount = std::stoi(argv[i + 1]);
+			}
+			else {
+				printUsage();
+				return 1;
+			}
+		}
+		if (std::string(argv[i]) == "--scene-seed") {
+			if (i + 1 < argc) {
+				sceneSeed = (unsigned int)std::stoul(argv[i + 1]);
+			}
+			else {
+				printUsage();
+				return 1;
+			}
+		}
+		if (std::string(argv[i]) == "--scene-path") {
+			scenePath = true;
+		}
+		if (std::string(argv[i]) == "--moving-caster") {
+			movingCaster = true;
+		}
+		if (std::string(argv[i]) == "--headless") {
+			headless = true;
+		}
+		if (std::string(argv[i]) == "--width" || std::string(argv[i]) == "--height") {
+			if (i + 1 < argc && std::stoi(argv[i + 1]) > 0) {
+				(std::string(argv[i]) == "--width" ? renderWidth : renderHeight) = std::stoi(argv[i + 1]);
+			}
+			else {
+				printUsage();
+				return 1;
+			}
+		}
+		if (std::string(argv[i]) == "--frames") {
+			if (i + 1 < argc && std::stoi(argv[i + 1]) >= 0) {
+				headlessFrames = std::stoi(argv[i + 1]);
+			}
+			else {
+				printUsage();
+				return 1;
+			}
+		}
+		if (std::string(argv[i]) == "--gpu-profile") {
+			if (i + 1 < argc) {
+				gpuProfileFile = argv[i + 1];
+			}
+			else {
+				printUsage();
+				return 1;
+			}
+		}
+		if (std::string(argv[i]) == "--trace") {
+			if (i + 1 < argc) {
+				traceFile = argv[i + 1];
+			}
+			else {
+				printUsage();
+				return 1;
+			}
+		}
+		if (std::string(argv[i]) == "--texture-cache") {
+			if (i + 1 < argc) {
+				textureCacheFile = std::string(argv[i + 1]) == "none" ? "" : argv[i + 1];
+			}
+			else {
+				printUsage();
+				return 1;
+			}
+		}
+		if (std::string(argv[i]) == "--report") {
+			if (i + 1 < argc) {
+				reportFile = argv[i + 1];
+			}
+			else {
+				printUsage();
+				return 1;
+			}
+		}
 	}
 
     // glfw: initialize and configure
@@ -71,14 +282,28 @@ int main(int argc, char* argv[])
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-	glfwWindowHint(GLFW_SAMPLES, samples);
+	// multisampling happens in the render target, the window itself has no samples
+	glfwWindowHint(GLFW_SAMPLES, 0);
 
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
+	if (headless) {
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	}
 
     // glfw window creation
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Window", NULL, NULL);
+    GLFWwindow* window = glfwCreateWindow(renderWidth, renderHeight, "Window", NULL, NULL);
+	if (window == NULL && headless) {
+		// no display (build server): try a context without a window system, works if glfw was built with OSMesa or EGL
+		for (int api : { GLFW_OSMESA_CONTEXT_API, GLFW_EGL_CONTEXT_API }) {
+			glfwWindowHint(GLFW_CONTEXT_CREATION_API, api);
+			window = glfwCreateWindow(renderWidth, renderHeight, "Window", NULL, NULL);
+			if (window != NULL) {
+				break;
+			}
+		}
+	}
     if (window == NULL)
     {
         std::cout << "Failed to create GLFW window" << std::endl;
@@ -87,6 +312,10 @@ int main(int argc, char* argv[])
     }
     glfwMakeContextCurrent(window);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    // the framebuffer can be larger than the window on high dpi displays
+    int framebufferWidth, framebufferHeight;
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    framebuffer_size_callback(window, framebufferWidth, framebufferHeight);
 
     // glad: load all OpenGL function pointers
     // ---------------------------------------
@@ -98,11 +327,11 @@ int main(int argc, char* argv[])
 
 	// build and compile our shader program
 	Shader ourShader("src/shader.vs", "src/shader.fs");
-	Shader depthShader("src/depthShader.vs", "src/depthShader.fs");
+	Shader depthShader("src/depthShader.vs", "src/depthShader.fs", "src/depthShader.gs");
 
     // configure global opengl state
-    glEnable(GL_DEPTH_TEST);
-	glEnable(GL_MULTISAMPLE);
+    glState().setCapability(GL_DEPTH_TEST, true);
+	glState().setCapability(GL_MULTISAMPLE, true);
 
     // world space positions cubesALso
     glm::vec3 cubePositions[] = {
@@ -204,7 +433,7 @@ int main(int argc, char* argv[])
 	unsigned int planeVBO;
 	glGenVertexArrays(1, &planeVAO);
 	glGenBuffers(1, &planeVBO);
-	glBindVertexArray(planeVAO);
+	glState().bindVertexArray(planeVAO);
 	glBindBuffer(GL_ARRAY_BUFFER, planeVBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(planeVertices), planeVertices, GL_STATIC_DRAW);
 	glEnableVertexAttribArray(0);
@@ -215,114 +444,265 @@ int main(int argc, char* argv[])
 	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
 	glEnableVertexAttribArray(3);
 	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(8 * sizeof(float)));
-	glBindVertexArray(0);
-
-	// load textures
-	unsigned int diffuseMap = loadTexture("src/brickwall.jpg");
-	unsigned int normalMap = loadTexture("src/brickwall_normal.jpg");
+	glState().bindVertexArray(0);
+
+	// load textures in the background into the material arrays, until they are uploaded the diffuse layers are grey
+	// and the normal layers flat
+	TextureLoader textureLoader(textureCacheFile);
+	MaterialLibrary materialLibrary(1024);
+	int brickLayer = materialLibrary.add("src/brickwall.jpg", "src/brickwall_normal.jpg");
+	materialLibrary.build(textureLoader);
+
+	// meshes, materials and programs are registered once, the queue sorts by their ids
+	RenderQueue renderQueue;
+	unsigned int litProgram = renderQueue.addProgram(&ourShader);
+	unsigned int brickMaterial = renderQueue.addMaterial(materialLibrary.material(brickLayer));
+	unsigned int planeMesh = renderQueue.addMesh({ planeVAO, 6, glm::vec3(-25.0f, -0.5f, -25.0f), glm::vec3(25.0f, -0.5f, 25.0f) });
+	unsigned int cubeMesh = renderQueue.addMesh(createCubeMesh());
+
+	// the demo scene or a generated one, everything is static
+	GeneratedScene generated;
+	if (sceneLayout != SCENE_DEMO) {
+		SceneGenerator generator(sceneSeed);
+		generated = generator.generate(sceneLayout, sceneCount);
+		if (scenePath) {
+			// the path goes through the drawn positions, which are twice the model positions (see shader.vs)
+			generator.generatePath(generated, 2.0f);
+		}
+		std::cout << "generated scene: " << generated.cubes.size() << " cubes, seed " << sceneSeed << std::endl;
+	}
+	const std::vector<glm::vec3> demoCubes(std::begin(cubePositions), std::end(cubePositions));
+	scene.reserve(generated.cubes.size() + demoCubes.size() + 1);
+	scene.push_back({ glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -2.0f, 0.0f)), planeMesh, brickMaterial, false });
+	for (const glm::vec3& position : sceneLayout == SCENE_DEMO ? demoCubes : generated.cubes) {
+		scene.push_back({ glm::translate(glm::mat4(1.0f), position), cubeMesh, brickMaterial, false });
+	}
+	// world space boxes of an object for the shadow casters and for the camera
+	auto worldBounds = [&renderQueue](const Renderable& object, glm::vec3& casterMin, glm::vec3& casterMax, glm::vec3& cameraMin, glm::vec3& cameraMax) {
+		const Mesh& mesh = renderQueue.mesh(object.mesh);
+		transformBounds(object.model, mesh.boundsMin, mesh.boundsMax, casterMin, casterMax);
+		// shader.vs applies the model matrix a second time for gl_Position, the camera sees the box moved twice
+		transformBounds(object.model * object.model, mesh.boundsMin, mesh.boundsMax, cameraMin, cameraMax);
+	};
+	auto addBounds = [&worldBounds](const Renderable& object) {
+		glm::vec3 casterMin, casterMax, cameraMin, cameraMax;
+		worldBounds(object, casterMin, casterMax, cameraMin, cameraMax);
+		casterBounds.add(casterMin, casterMax);
+		cameraBounds.add(cameraMin, cameraMax);
+	};
+	// boxes of object i after it was moved
+	auto placeBounds = [&worldBounds](size_t i) {
+		glm::vec3 casterMin, casterMax, cameraMin, cameraMax;
+		worldBounds(scene[i], casterMin, casterMax, cameraMin, cameraMax);
+		casterBounds.set(i, casterMin, casterMax);
+		cameraBounds.set(i, cameraMin, cameraMax);
+	};
+	for (const Renderable& object : scene) {
+		addBounds(object);
+	}
+	// index of the moving caster, added to the scene the first time it is started
+	size_t movingIndex = 0;
 
-	// configure depth map FBO
+	// cascaded depth map from the light, only re-rendered when a cascade or a caster changes
 	const unsigned int SHADOW_WIDTH = 1024, SHADOW_HEIGHT = 1024;
-	unsigned int depthMapFBO;
-	glGenFramebuffers(1, &depthMapFBO);
-	// create depth texture
-	unsigned int depthMap;
-	glGenTextures(1, &depthMap);
-	glBindTexture(GL_TEXTURE_2D, depthMap);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-	float borderColor[] = { 1.0, 1.0, 1.0, 1.0 };
-	glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-	// attach depth texture as FBO's depth buffer
-	glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMap, 0);
-	glDrawBuffer(GL_NONE);
-	glReadBuffer(GL_NONE);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	ShadowMap shadowMap(SHADOW_WIDTH, SHADOW_HEIGHT, SHADOW_CASCADES, shadowFormat);
+	shadowMap.refreshInterval = CASCADE_REFRESH_INTERVAL;
 
 	ourShader.use();
 	ourShader.setInt("diffuseTexture", 0);
 	ourShader.setInt("normalMap", 1);
 	ourShader.setInt("shadowMap", 2);
+
+	// per frame and light uniforms live in uniform buffers shared by both programs
+	UniformBuffer<FrameUniforms> frameUniforms(FRAME_BINDING);
+	UniformBuffer<LightUniforms> lightUniforms(LIGHT_BINDING);
+	for (Shader* shader : { &ourShader, &depthShader }) {
+		shader->bindUniformBlock("Frame", FRAME_BINDING);
+		shader->bindUniformBlock("Light", LIGHT_BINDING);
+	}
+	// the projection only changes with the render size, see the resize at the start of each frame
+	frameUniforms.data.projection = glm::perspective(FOV, (float)renderWidth / (float)renderHeight, NEAR_PLANE, FAR_PLANE);
 	
 	// lighting info
 	glm::vec3 lightPos(20.0f, 100.0f, 120.0f);
+	lightUniforms.data.lightPos = glm::vec4(lightPos, 1.0f);
+	lightUniforms.data.lightColor = glm::vec4(1.0f);
+	lightUniforms.upload();
 
 	// vars for calculation
-	float t = 0.0f;
-	int currentPointIndex = 1;
-	glm::quat lookDirQuaternions[20];
+	glm::quat lookDirQuaternions[CAMERPATHLENGTH];
 	glm::vec3 initialOrientation = glm::vec3(0.0f, 0.0f, -1.0f);
 
     //transform lookDir vectors to Quaternions
-	for (int i = 0; i < 20; i++) {
+	for (int i = 0; i < CAMERPATHLENGTH; i++) {
 		lookDirQuaternions[i] = glm::rotation(glm::normalize(initialOrientation), glm::normalize(lookDir[i]));
 	}
 
+	// keys of the built in path, or of the generated one
+	const glm::vec3* keyPositions = pathPos;
+	const glm::quat* keyOrientations = lookDirQuaternions;
+	int keyCount = CAMERPATHLENGTH;
+	if (!generated.pathPositions.empty()) {
+		keyPositions = generated.pathPositions.data();
+		keyOrientations = generated.pathOrientations.data();
+		keyCount = (int)generated.pathPositions.size();
+	}
+
+	if (!writePathTo.empty()) {
+		if (!writePathFile(writePathTo.c_str(), keyPositions, keyOrientations, nullptr, keyCount)) {
+			std::cout << "Failed to write path file: " << writePathTo << std::endl;
+		}
+	}
+
+	// a path file is mapped and used in place, segments are only prepared around the camera
+	MappedFile mappedPath;
+	PathKeys fileKeys;
+	bool useFile = !pathFile.empty() && mappedPath.open(pathFile.c_str()) && readPathFile(mappedPath, fileKeys);
+	if (!pathFile.empty() && !useFile) {
+		std::cout << "Failed to load path file: " << pathFile << ", using the built in path" << std::endl;
+	}
+	// the camera moves with constant speed along the arc length
+	CameraPath cameraPath = useFile ? CameraPath(fileKeys) : CameraPath(keyPositions, keyOrientations, keyCount);
+	// path speed in units per second, estimated from the first segments so long paths don't have to be walked
+	float pathSpeed = increment * 60.0f * cameraPath.averageSegmentLength();
+
+	// the camera is simulated in fixed steps and interpolated between the last two states for rendering
+	Clock clock(SIMULATION_STEP);
+	clock.setTimeScale(timeScale);
+	if (fixedFrameTime > 0.0f) {
+		clock.setDeterministic(fixedFrameTime);
+	}
+	CameraState currentCamera;
+	cameraPath.sample(0.0f, currentCamera.position, currentCamera.orientation);
+	CameraState previousCamera = currentCamera;
+
+	// visibility masks of the current frame and the culling totals for the report at exit
+	std::vector<uint8_t> cameraVisible, casterVisible;
+	struct {
+		double seconds = 0.0;
+		unsigned long long frames = 0, shadowFrames = 0, cameraVisible = 0, casterVisible = 0;
+	} cullStats;
+
+	ShadowBenchmark benchmark;
+	if (shadowBenchmark) {
+		benchmark.start();
+	}
+
+	// gpu time of the passes, read back a few frames late
+	GpuProfiler gpuProfiler;
+	int shadowScope = gpuProfiler.addScope("shadow");
+	int mainScope = gpuProfiler.addScope("main");
+	int postScope = gpuProfiler.addScope("post");
+	if (!gpuProfileFile.empty() && !gpuProfiler.openCsv(gpuProfileFile.c_str())) {
+		std::cout << "Failed to open gpu profile file: " << gpuProfileFile << std::endl;
+	}
+
+	// the lit pass renders into a multisampled framebuffer that is resolved into the window,
+	// headless into an offscreen framebuffer instead of the (invisible) window
+	RenderTarget renderTarget(headless);
+	if (!renderTarget.resize(renderWidth, renderHeight, samples)) {
+		std::cout << "ERROR::FRAMEBUFFER:: Render target is not complete!" << std::endl;
+		glfwTerminate();
+		return -1;
+	}
+	samples = renderTarget.samples();
+	FrameReport report;
+	int frameCount = 0;
+	bool pathLooped = false;
+	if (headless) {
+		report.describe("width", renderWidth);
+		report.describe("height", renderHeight);
+		report.describe("samples", samples);
+		report.describe("objects", (double)scene.size());
+		report.start();
+		gpuProfiler.keepFrames();
+	}
+
+	// measured frames should not contain placeholders
+	if (headless || shadowBenchmark) {
+		textureLoader.waitAll();
+	}
+
+	PROFILE_THREAD("main");
+	if (!traceFile.empty() && !PROFILE_START(traceFile.c_str())) {
+		std::cout << "Failed to start the cpu trace: " << traceFile << " (the build needs EZG_PROFILE)" << std::endl;
+	}
+
     // render loop
     while (!glfwWindowShouldClose(window))
     {
-		if (t < 1) {
-            t += increment;
+		PROFILE_ZONE("frame");
+		auto frameStart = std::chrono::steady_clock::now();
+		{
+			PROFILE_ZONE("path");
+			int steps = clock.advance();
+			for (int i = 0; i < steps; i++) {
+				previousCamera = currentCamera;
+				currentCamera.distance += pathSpeed * (float)clock.stepSize();
+				if (cameraPath.pastEnd(currentCamera.distance)) {
+					// jump back to the start without blending across the whole path
+					currentCamera.distance -= cameraPath.length();
+					pathLooped = true;
+					cameraPath.sample(currentCamera.distance, currentCamera.position, currentCamera.orientation);
+					previousCamera = currentCamera;
+				}
+				else {
+					cameraPath.sample(currentCamera.distance, currentCamera.position, currentCamera.orientation);
+				}
+			}
 		}
-		else {
-			currentPointIndex = calcCorrectIndex(currentPointIndex);
-			t = 0.0f;
+
+        // input
+		{
+			PROFILE_ZONE("input");
+			processInput(window);
 		}
 
-		if (currentPointIndex > CAMERPATHLENGTH) {
-			currentPointIndex = 1;
-		}  
+		// the moving caster follows the simulated time, switching between dynamic and static rebuilds the static cache
+		if (movingCaster && movingIndex == 0) {
+			scene.push_back({ glm::mat4(1.0f), cubeMesh, brickMaterial, false });
+			addBounds(scene.back());
+			movingIndex = scene.size() - 1;
+		}
+		if (movingIndex != 0) {
+			Renderable& caster = scene[movingIndex];
+			if (caster.dynamic != movingCaster) {
+				caster.dynamic = movingCaster;
+				shadowMap.invalidateStatic();
+			}
+			if (caster.dynamic) {
+				float angle = (float)clock.time() * 0.8f;
+				caster.model = glm::translate(glm::mat4(1.0f), glm::vec3(3.0f * std::cos(angle), 0.5f, 3.0f * std::sin(angle)));
+				placeBounds(movingIndex);
+				shadowMap.invalidateDynamic();
+			}
+		}
 
-        // input
-        processInput(window);
+		{
+			PROFILE_ZONE("texture upload");
+			textureLoader.update();
+		}
+
+		// the window was resized or a different sample count was selected, only the renderbuffers are recreated
+		if (samples != renderTarget.samples() || (int)renderWidth != renderTarget.width() || (int)renderHeight != renderTarget.height()) {
+			if (!renderTarget.resize(renderWidth, renderHeight, samples)) {
+				std::cout << "ERROR::FRAMEBUFFER:: Render target with " << samples << " samples is not complete!" << std::endl;
+				renderTarget.resize(renderWidth, renderHeight, 0);
+			}
+			samples = renderTarget.samples();
+			frameUniforms.data.projection = glm::perspective(FOV, (float)renderWidth / (float)renderHeight, NEAR_PLANE, FAR_PLANE);
+		}
 
 		// render
+		gpuProfiler.beginFrame();
+		glState().bindFramebuffer(GL_FRAMEBUFFER, renderTarget.framebuffer());
 		glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		// 1. render depth of scene to texture (from light's perspective)
-		ourShader.setFloat("bumpiness", bumpiness);
-		glm::mat4 lightProjection, lightView;
-		glm::mat4 lightSpaceMatrix;
-		float near_plane = 0.1f, far_plane = 200.0f;
-		lightProjection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, near_plane, far_plane);
-		lightView = glm::lookAt(lightPos, glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(0.0, 1.0, 0.0));
-		lightSpaceMatrix = lightProjection * lightView;
-		// render scene from light's point of view
-		depthShader.use();
-		depthShader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
-
-		glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-		glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-		glClear(GL_DEPTH_BUFFER_BIT);
-		glCullFace(GL_FRONT);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, diffuseMap);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, normalMap);
-		renderScene(depthShader, cubePositions);
-		glCullFace(GL_BACK);
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-        // render scene second time normally
-		glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		ourShader.use();
-		// pass projection matrix to shader
-		glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-		ourShader.setMat4("projection", projection);
-
-		tangents = calcTangents(pathPos[currentPointIndex - 1], pathPos[currentPointIndex], pathPos[currentPointIndex + 1], pathPos[currentPointIndex + 2]);
-		//calculate the helper quats for p0 and p1
-		glm::quat helpQuat1 = glm::intermediate(lookDirQuaternions[currentPointIndex - 1], lookDirQuaternions[currentPointIndex], lookDirQuaternions[currentPointIndex + 1]);
-		glm::quat helpQuat2 = glm::intermediate(lookDirQuaternions[currentPointIndex], lookDirQuaternions[currentPointIndex + 1], lookDirQuaternions[currentPointIndex + 2]);
-		// calculate the point the camera will move to and the direction it will look
-		glm::vec3 movePoint = calcPoint(t, pathPos[currentPointIndex], pathPos[currentPointIndex + 1], tangents[0], tangents[1]);
-		glm::quat lookQuat = glm::squad(lookDirQuaternions[currentPointIndex], lookDirQuaternions[currentPointIndex + 1], helpQuat1, helpQuat2, t);
+		// interpolate the point the camera moves to and the direction it looks between the last two steps
+		CameraState camera = mixCameraState(previousCamera, currentCamera, (float)clock.alpha());
+		glm::vec3 movePoint = camera.position;
+		glm::quat lookQuat = camera.orientation;
 
 		// camera/view transformation
 		glm::mat4 view = glm::lookAt(movePoint, movePoint + lookQuat * initialOrientation, glm::vec3(0.0f, 1.0f, 0.0f));
@@ -331,132 +711,258 @@ int main(int argc, char* argv[])
 		//glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 3.0f, 15.0f), glm::vec3(0, -3, 3), glm::vec3(0.0f, 1.0f, 0.0f));
 		// close up test
 		//glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 2.0f, 4.0f), glm::vec3(0, -5, 3), glm::vec3(0.0f, 1.0f, 0.0f));
-		
-		ourShader.setMat4("view", view);
-
-		//ourShader.setVec3("objectColor", 0.2f, 0.5f, 0.31f);
-		ourShader.setVec3("viewPos", glm::vec3(0, 0, 0));
-		//ourShader.setVec3("viewPos", movePoint);
-		ourShader.setVec3("lightPos", lightPos);
-		ourShader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, diffuseMap);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, normalMap);
-		glActiveTexture(GL_TEXTURE2);
-		glBindTexture(GL_TEXTURE_2D, depthMap);
-
-		renderScene(ourShader, cubePositions);
+
+		if (benchmark.active()) {
+			shadowMap.setDepthFormat(benchmark.format());
+			shadowTaps = benchmark.taps();
+		}
+
+		// 1. render depth of scene to texture (from light's perspective)
+		// cascades fitted to the slices of the camera frustum, the light shines from lightPos towards the scene center
+		glm::vec3 lightDir = glm::normalize(glm::vec3(0.0f, 0.0f, 5.0f) - lightPos);
+		shadowMap.fit(view, FOV, (float)renderWidth / (float)renderHeight, NEAR_PLANE, FAR_PLANE, lightDir);
+
+		// everything both passes need for this frame in one upload
+		FrameUniforms& frame = frameUniforms.data;
+		frame.view = view;
+		frame.viewProjection = frame.projection * view;
+		for (int c = 0; c < MAX_CASCADES; c++) {
+			frame.lightSpaceMatrices[c] = shadowMap.getLightSpaceMatrix(c);
+		}
+		frame.viewPos = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		//frame.viewPos = glm::vec4(movePoint, 1.0f);
+		frame.cascadeCount = shadowMap.cascadeCount;
+		frame.shadowTaps = shadowTaps;
+		frame.bumpiness = bumpiness;
+		frameUniforms.upload();
+
+		// collect and sort the draw packets of the frame, shadow packets only when the shadow map is re-rendered
+		bool hasDynamic = std::any_of(scene.begin(), scene.end(), [](const Renderable& object) { return object.dynamic; });
+		bool shadows = shadowMap.needsUpdate(hasDynamic);
+
+		// objects outside the camera frustum are not drawn, objects outside every cascade cast no shadow
+		{
+			PROFILE_ZONE("cull");
+			auto cullStart = std::chrono::steady_clock::now();
+			cullStats.cameraVisible += cameraBounds.cull(Frustum(frame.viewProjection), cameraVisible);
+			if (shadows) {
+				Frustum cascades[MAX_CASCADES];
+				for (int c = 0; c < shadowMap.cascadeCount; c++) {
+					cascades[c] = Frustum(shadowMap.getLightSpaceMatrix(c));
+				}
+				cullStats.casterVisible += casterBounds.cull(cascades, shadowMap.cascadeCount, casterVisible);
+				cullStats.shadowFrames++;
+			}
+			cullStats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - cullStart).count();
+			cullStats.frames++;
+		}
+
+		{
+			PROFILE_ZONE("render queue");
+			buildRenderQueue(renderQueue, litProgram, view, shadows, cameraVisible, casterVisible);
+			renderQueue.upload();
+		}
+
+		// render all changed cascades in one layered pass, skipped while the cached depth map is still valid
+		{
+			PROFILE_ZONE("shadow submit");
+			gpuProfiler.begin(shadowScope);
+			shadowMap.update(depthShader, hasDynamic,
+				[&renderQueue]() { renderQueue.submit(PASS_SHADOW_STATIC); },
+				[&renderQueue]() { renderQueue.submit(PASS_SHADOW_DYNAMIC); });
+			gpuProfiler.end(shadowScope);
+		}
+		unsigned long long shadowDraws = renderQueue.drawCalls;
+		unsigned long long shadowTriangles = renderQueue.triangles;
+
+        // render scene second time normally
+		glState().bindFramebuffer(GL_FRAMEBUFFER, renderTarget.framebuffer());
+		glState().viewport(0, 0, renderWidth, renderHeight);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		glState().bindTexture(2, GL_TEXTURE_2D_ARRAY, shadowMap.texture());
+
+		{
+			PROFILE_ZONE("main submit");
+			gpuProfiler.begin(mainScope);
+			benchmark.beginPass();
+			renderQueue.submit(PASS_OPAQUE);
+			if (shadowBenchmark && !benchmark.endPass(renderWidth * renderHeight)) {
+				glfwSetWindowShouldClose(window, true);
+			}
+			gpuProfiler.end(mainScope);
+		}
+
+		// everything after the lit pass: msaa resolve and the overlay on top of the resolved image
+		gpuProfiler.begin(postScope);
+		renderTarget.resolve();
+		if (showGpuOverlay) {
+			gpuProfiler.drawOverlay(renderWidth, renderHeight);
+		}
+		gpuProfiler.end(postScope);
+		gpuProfiler.endFrame();
+
+        glState().endFrame();
+
+		if (headless) {
+			// nothing to show, the frame only has to reach the gpu
+			glFlush();
+			report.endFrame(std::chrono::duration<double>(std::chrono::steady_clock::now() - frameStart).count(),
+				shadowDraws, renderQueue.drawCalls - shadowDraws, shadowTriangles, renderQueue.triangles - shadowTriangles);
+			frameCount++;
+			if (headlessFrames > 0 ? frameCount >= headlessFrames : pathLooped) {
+				glfwSetWindowShouldClose(window, true);
+			}
+			glfwPollEvents();
+			continue;
+		}
 
         // glfw: swap buffers and poll events
-        glfwSwapBuffers(window);
+		{
+			PROFILE_ZONE("swap");
+			glfwSwapBuffers(window);
+		}
         glfwPollEvents();
     }
+	PROFILE_STOP();
+
+	gpuProfiler.flush();
+	if (report.active()) {
+		if (reportFile.empty()) {
+			report.finish(std::cout, gpuProfiler);
+		}
+		else {
+			std::ofstream out(reportFile);
+			report.finish(out, gpuProfiler);
+		}
+	}
+
+	std::cout << "GPU time per frame (last " << GpuProfiler::HISTORY << " frames):";
+	for (int s = 0; s < gpuProfiler.scopeCount(); s++) {
+		std::cout << " " << gpuProfiler.name(s) << " " << gpuProfiler.average(s) << " ms";
+	}
+	std::cout << std::endl;
+
+	if (glState().frames() > 0) {
+		double frames = (double)glState().frames();
+		std::cout << "GL state changes per frame: " << glState().totalIssued() / frames << " issued, "
+			<< glState().totalElided() / frames << " elided" << std::endl;
+	}
+	if (cullStats.frames > 0) {
+		double frames = (double)cullStats.frames;
+		std::cout << "culling: " << cullStats.seconds * 1000.0 / frames << " ms per frame, camera "
+			<< cullStats.cameraVisible / frames << " of " << scene.size() << " objects drawn";
+		if (cullStats.shadowFrames > 0) {
+			std::cout << ", shadow casters " << cullStats.casterVisible / (double)cullStats.shadowFrames << " of " << scene.size();
+		}
+		std::cout << std::endl;
+	}
 
     // de-allocate all resources
 	glDeleteVertexArrays(1, &planeVAO);
 	glDeleteBuffers(1, &planeVBO);
+	glDeleteVertexArrays(1, &cubeVAO);
+	glDeleteBuffers(1, &cubeVBO);
+	renderQueue.release();
+	gpuProfiler.release();
+	renderTarget.release();
+	textureLoader.release();
+	materialLibrary.release();
+	shadowMap.release();
+	frameUniforms.release();
+	lightUniforms.release();
 
     // glfw: terminate
     glfwTerminate();
     return 0;
 }
 
-void renderScene(const Shader& shader, const glm::vec3 cubePos[])
+// packets for every object of the scene: lit pass sorted front to back, shadow passes in scene order
+void buildRenderQueue(RenderQueue& queue, unsigned int program, const glm::mat4& view, bool shadows,
+	const std::vector<uint8_t>& cameraVisible, const std::vector<uint8_t>& casterVisible)
 {
-	// floor plane
-	glm::mat4 model = glm::mat4(1.0f);
-	model = glm::translate(model, glm::vec3(0.0f, -2.0f, 0.0f));
-	shader.setMat4("model", model);
-	glBindVertexArray(planeVAO);
-	glDrawArrays(GL_TRIANGLES, 0, 6);
-
-	// cubes
-	for (unsigned int i = 0; i < 17; i++)
+	queue.clear();
+	for (size_t i = 0; i < scene.size(); i++)
 	{
-		// calculate the model matrix for each object and pass it to shader before drawing
-		glm::mat4 model = glm::mat4(1.0f);
-		model = glm::translate(model, cubePos[i]);
-		shader.setMat4("model", model);
-		renderCube();
+		const Renderable& object = scene[i];
+		if (shadows && Culler::isVisible(casterVisible, i))
+			queue.add(object.dynamic ? PASS_SHADOW_DYNAMIC : PASS_SHADOW_STATIC, RenderQueue::KEEP, RenderQueue::KEEP, object.mesh, object.model);
+		if (!Culler::isVisible(cameraVisible, i))
+			continue;
+		// distance in front of the camera, the view looks down -z
+		float depth = -(view * object.model[3]).z;
+		queue.add(PASS_OPAQUE, program, object.material, object.mesh, object.model, depth);
 	}
+	queue.sort();
 }
 
-unsigned int cubeVAO = 0;
-unsigned int cubeVBO = 0;
-void renderCube()
+// cube vao with position, normal, uv and tangent, the model matrices come from the render queue
+Mesh createCubeMesh()
 {
-	if (cubeVAO == 0)
-	{
-		// vertex data
-		float vertices[] = {
-			// positions          // normals          // texture	// tangents
-			-0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,	1.0f, 0.0f, 0.0f,
-			0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 0.0f,	1.0f, 0.0f, 0.0f,
-			0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,	1.0f, 0.0f, 0.0f,
-			0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,	1.0f, 0.0f, 0.0f,
-			-0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 1.0f,	1.0f, 0.0f, 0.0f,
-			-0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,	1.0f, 0.0f, 0.0f,
-
-			-0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,	1.0f, 0.0f, 0.0f,
-			0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 0.0f,	1.0f, 0.0f, 0.0f,
-			0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,	1.0f, 0.0f, 0.0f,
-			0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,	1.0f, 0.0f, 0.0f,
-			-0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 1.0f,	1.0f, 0.0f, 0.0f,
-			-0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,	1.0f, 0.0f, 0.0f,
-
-			-0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,	0.0f, 1.0f, 0.0f,
-			-0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 1.0f,	0.0f, 1.0f, 0.0f,
-			-0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,	0.0f, 1.0f, 0.0f,
-			-0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,	0.0f, 1.0f, 0.0f,
-			-0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 0.0f,	0.0f, 1.0f, 0.0f,
-			-0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,	0.0f, 1.0f, 0.0f,
-
-			 0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,	0.0f, -1.0f, 0.0f,
-			 0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f,	0.0f, -1.0f, 0.0f,
-			 0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,	0.0f, -1.0f, 0.0f,
-			 0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,	0.0f, -1.0f, 0.0f,
-			 0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 0.0f,	0.0f, -1.0f, 0.0f,
-			 0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,	0.0f, -1.0f, 0.0f,
-
-			-0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,	1.0f, 0.0f, 0.0f,
-			 0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 1.0f,	1.0f, 0.0f, 0.0f,
-			 0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,	1.0f, 0.0f, 0.0f,
-			 0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,	1.0f, 0.0f, 0.0f,
-			-0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 0.0f,	1.0f, 0.0f, 0.0f,
-			-0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,	1.0f, 0.0f, 0.0f,
-
-			-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f,	1.0f, 0.0f, 0.0f,
-			 0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 1.0f,	1.0f, 0.0f, 0.0f,
-			 0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,	1.0f, 0.0f, 0.0f,
-			 0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,	1.0f, 0.0f, 0.0f,
-			-0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 0.0f,	1.0f, 0.0f, 0.0f,
-			-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f,	1.0f, 0.0f, 0.0f 
-		};
-		// configure cube vao and vbo
-		glGenVertexArrays(1, &cubeVAO);
-		glGenBuffers(1, &cubeVBO);
-
-		glBindVertexArray(cubeVAO);
-
-		glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(3 * sizeof(float)));
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
-		glEnableVertexAttribArray(3);
-		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(8 * sizeof(float)));
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindVertexArray(0);
-		
-	}
-
-	glBindVertexArray(cubeVAO);
-	glDrawArrays(GL_TRIANGLES, 0, 36);
-	glBindVertexArray(0);
+	// vertex data
+	float vertices[] = {
+		// positions          // normals          // texture	// tangents
+		-0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,	1.0f, 0.0f, 0.0f,
+		0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 0.0f,	1.0f, 0.0f, 0.0f,
+		0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,	1.0f, 0.0f, 0.0f,
+		0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,	1.0f, 0.0f, 0.0f,
+		-0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 1.0f,	1.0f, 0.0f, 0.0f,
+		-0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,	1.0f, 0.0f, 0.0f,
+
+		-0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,	1.0f, 0.0f, 0.0f,
+		0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 0.0f,	1.0f, 0.0f, 0.0f,
+		0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,	1.0f, 0.0f, 0.0f,
+		0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,	1.0f, 0.0f, 0.0f,
+		-0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 1.0f,	1.0f, 0.0f, 0.0f,
+		-0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,	1.0f, 0.0f, 0.0f,
+
+		-0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,	0.0f, 1.0f, 0.0f,
+		-0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 1.0f,	0.0f, 1.0f, 0.0f,
+		-0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,	0.0f, 1.0f, 0.0f,
+		-0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,	0.0f, 1.0f, 0.0f,
+		-0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 0.0f,	0.0f, 1.0f, 0.0f,
+		-0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,	0.0f, 1.0f, 0.0f,
+
+		 0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,	0.0f, -1.0f, 0.0f,
+		 0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f,	0.0f, -1.0f, 0.0f,
+		 0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,	0.0f, -1.0f, 0.0f,
+		 0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,	0.0f, -1.0f, 0.0f,
+		 0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 0.0f,	0.0f, -1.0f, 0.0f,
+		 0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,	0.0f, -1.0f, 0.0f,
+
+		-0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,	1.0f, 0.0f, 0.0f,
+		 0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 1.0f,	1.0f, 0.0f, 0.0f,
+		 0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,	1.0f, 0.0f, 0.0f,
+		 0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,	1.0f, 0.0f, 0.0f,
+		-0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 0.0f,	1.0f, 0.0f, 0.0f,
+		-0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,	1.0f, 0.0f, 0.0f,
+
+		-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f,	1.0f, 0.0f, 0.0f,
+		 0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 1.0f,	1.0f, 0.0f, 0.0f,
+		 0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,	1.0f, 0.0f, 0.0f,
+		 0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,	1.0f, 0.0f, 0.0f,
+		-0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 0.0f,	1.0f, 0.0f, 0.0f,
+		-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f,	1.0f, 0.0f, 0.0f 
+	};
+	// configure cube vbo
+	glGenBuffers(1, &cubeVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+	// configure cube vao
+	glGenVertexArrays(1, &cubeVAO);
+	glState().bindVertexArray(cubeVAO);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(3 * sizeof(float)));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(8 * sizeof(float)));
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glState().bindVertexArray(0);
+
+	return { cubeVAO, 36, glm::vec3(-0.5f), glm::vec3(0.5f) };
 }
 
 // process all input
@@ -475,100 +981,67 @@ void processInput(GLFWwindow* window)
 			bumpiness -= 0.1f;
 	}
 
+	// msaa samples, the render target is recreated at the start of the next frame
 	if (glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS) {
-		glDisable(GL_MULTISAMPLE);
+		samples = 0;
 	}
 
 	if (glfwGetKey(window, GLFW_KEY_2) == GLFW_PRESS) {
-		glEnable(GL_MULTISAMPLE);
+		samples = 2;
 	}
-}
-
-//  window size
-void framebuffer_size_callback(GLFWwindow* window, int width, int height)
-{
-    // make sure the viewport matches the new window dimensions; note that width and 
-    // height will be significantly larger than specified on retina displays.
-    glViewport(0, 0, width, height);
-}
 
-// calculate index for points, modulo for array reset
-int calcCorrectIndex(int index) {
-	index++;
-	int mod = index % 18;
-	if (mod == 0) {
-		return 1;
+	if (glfwGetKey(window, GLFW_KEY_3) == GLFW_PRESS) {
+		samples = 4;
 	}
-	return mod;
-}
 
-//calculate tangents p1 and p2 as helper values
-std::vector<glm::vec3> calcTangents(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2, glm::vec3 p3) {
-	float t = 0.0f;
-	float b = 0.0f;
-	float c = 0.0f;
+	if (glfwGetKey(window, GLFW_KEY_4) == GLFW_PRESS) {
+		samples = 8;
+	}
 
-	std::vector<glm::vec3> results(2);
+	// PCF taps per fragment
+	if (glfwGetKey(window, GLFW_KEY_F1) == GLFW_PRESS) {
+		shadowTaps = 1;
+	}
 
-	float coef1 = ((1 - t) * (1 + b) * (1 + c)) / 2;
-	float coef2 = ((1 - t) * (1 - b) * (1 - c)) / 2;
-	float coef3 = ((1 - t) * (1 + b) * (1 - c)) / 2;
-	float coef4 = ((1 - t) * (1 - b) * (1 + c)) / 2;
+	if (glfwGetKey(window, GLFW_KEY_F2) == GLFW_PRESS) {
+		shadowTaps = 4;
+	}
 
-	glm::vec3 tang1 = coef1 * (p1 - p0) + coef2 * (p2 - p1);
-	glm::vec3 tang2 = coef3 * (p2 - p1) + coef4 * (p3 - p2);
-	results[0] = tang1;
-	results[1] = tang2;
-	return results;
-}
+	if (glfwGetKey(window, GLFW_KEY_F3) == GLFW_PRESS) {
+		shadowTaps = 9;
+	}
 
-//calculate the point between p0 and p1 based on the t value
-glm::vec3 calcPoint(float t, glm::vec3 p0, glm::vec3 p1, glm::vec3 tang1, glm::vec3 tang2) {
-	float t2 = t * t;
-	float t3 = t * t * t;
+	if (glfwGetKey(window, GLFW_KEY_F4) == GLFW_PRESS) {
+		shadowTaps = 16;
+	}
 
-	float h00 = 2 * t2 - 3 * t2 + 1;
-	float h10 = t3 - 2 * t2 + t;
-	float h01 = -2 * t3 + 3 * t3;
-	float h11 = t3 - t2;
+	// gpu pass times overlay
+	if (glfwGetKey(window, GLFW_KEY_F5) == GLFW_PRESS) {
+		showGpuOverlay = true;
+	}
 
-	return h00 * p0 + h10 * tang1 + h01 * p1 + h11 * tang2;
-}
+	if (glfwGetKey(window, GLFW_KEY_F6) == GLFW_PRESS) {
+		showGpuOverlay = false;
+	}
 
-// utility function for loading a 2D texture from file
-unsigned int loadTexture(char const* path)
-{
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
+	// moving shadow caster
+	if (glfwGetKey(window, GLFW_KEY_F7) == GLFW_PRESS) {
+		movingCaster = true;
+	}
 
-	int width, height, nrComponents;
-	unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
-	if (data)
-	{
-		GLenum format;
-		if (nrComponents == 1)
-			format = GL_RED;
-		else if (nrComponents == 3)
-			format = GL_RGB;
-		else if (nrComponents == 4)
-			format = GL_RGBA;
-
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT); 
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		stbi_image_free(data);
-	}
-	else
-	{
-		std::cout << "Texture failed to load at path: " << path << std::endl;
-		stbi_image_free(data);
+	if (glfwGetKey(window, GLFW_KEY_F8) == GLFW_PRESS) {
+		movingCaster = false;
 	}
+}
 
-	return textureID;
+//  window size
+void framebuffer_size_callback(GLFWwindow* window, int width, int height)
+{
+    // the render target, the viewport and the projection follow the new size at the start of the next frame;
+    // note that width and height will be significantly larger than specified on retina displays.
+    // A minimized window reports 0 and keeps the old size, headless renders at a fixed size.
+    if (headless || width <= 0 || height <= 0)
+        return;
+    renderWidth = width;
+    renderHeight = height;
 }
\ No newline at end of file
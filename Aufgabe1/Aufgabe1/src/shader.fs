@@ -1,82 +1,111 @@
 #version 330 core
+#define MAX_CASCADES 4
 out vec4 FragColor;
 
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
-in vec4 FragPosLightSpace;
 
 in mat3 TBN;
+flat in int MaterialLayer;
 
-uniform sampler2D diffuseTexture;
-uniform sampler2D normalMap;
-uniform sampler2D shadowMap;
-  
-uniform vec3 lightPos; 
-uniform vec3 viewPos;
-uniform float bumpiness;
+// one layer per material (MaterialLibrary.h)
+uniform sampler2DArray diffuseTexture;
+uniform sampler2DArray normalMap;
+uniform sampler2DArrayShadow shadowMap;
 
-float ShadowCalculation(vec4 fragPosLightSpace)
+// shared with all programs, has to match FrameUniforms in UniformBuffers.h
+layout (std140) uniform Frame
 {
-    // perform perspective divide
-    vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
-    // transform to [0,1] range
-    projCoords = projCoords * 0.5 + 0.5;
-    // get closest depth value from light's perspective (using [0,1] range fragPosLight as coords)
-    float closestDepth = texture(shadowMap, projCoords.xy).r; 
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    mat4 lightSpaceMatrices[MAX_CASCADES];
+    vec4 viewPos;
+    int cascadeCount;
+    int shadowTaps;
+    float bumpiness;
+};
+
+// has to match LightUniforms in UniformBuffers.h
+layout (std140) uniform Light
+{
+    vec4 lightPos;
+    vec4 lightColor;
+};
+
+float ShadowCalculation(vec3 fragPos)
+{
+    // use the first (finest) cascade that covers the fragment, distant cascades may lag behind
+    // the camera a few frames so the covered region is tested instead of the split distance
+    vec3 projCoords = vec3(0.0, 0.0, 2.0);
+    int layer = 0;
+    for(int c = 0; c < cascadeCount; ++c)
+    {
+        vec4 fragPosLightSpace = lightSpaceMatrices[c] * vec4(fragPos, 1.0);
+        // perform perspective divide and transform to [0,1] range
+        vec3 coords = fragPosLightSpace.xyz / fragPosLightSpace.w * 0.5 + 0.5;
+        if(all(greaterThanEqual(coords, vec3(0.0))) && all(lessThanEqual(coords, vec3(1.0))))
+        {
+            projCoords = coords;
+            layer = c;
+            break;
+        }
+    }
+    // keep the shadow at 0.0 when outside the far_plane region of the light's frustum.
+    if(projCoords.z > 1.0)
+        return 0.0;
     // get depth of current fragment from light's perspective
     float currentDepth = projCoords.z;
     // calculate bias (based on depth map resolution and slope)
     vec3 normal = normalize(Normal);
-    vec3 lightDir = normalize(lightPos - FragPos);
+    vec3 lightDir = normalize(lightPos.xyz - FragPos);
     float bias = max(0.05 * (1.0 - dot(normal, lightDir)), 0.005);
     // check whether current frag pos is in shadow
-    // PCF
-    float shadow = 0.0;
-    vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
-    for(int x = -1; x <= 1; ++x)
+    // PCF, kernel x kernel taps centered on the fragment, each tap compares and filters 2x2 texels in hardware
+    int kernel = int(sqrt(float(shadowTaps)) + 0.5);
+    float start = -0.5 * float(kernel - 1);
+    vec2 texelSize = 1.0 / textureSize(shadowMap, 0).xy;
+    float lit = 0.0;
+    for(int x = 0; x < kernel; ++x)
     {
-        for(int y = -1; y <= 1; ++y)
+        for(int y = 0; y < kernel; ++y)
         {
-            float pcfDepth = texture(shadowMap, projCoords.xy + vec2(x, y) * texelSize).r; 
-            shadow += currentDepth - bias > pcfDepth  ? 1.0 : 0.0;        
-        }    
+            vec2 offset = (vec2(x, y) + start) * texelSize;
+            lit += texture(shadowMap, vec4(projCoords.xy + offset, layer, currentDepth - bias));
+        }
     }
-    shadow /= 9.0;
-    
-    // keep the shadow at 0.0 when outside the far_plane region of the light's frustum.
-    if(projCoords.z > 1.0)
-        shadow = 0.0;
-        
-    return shadow;
+    return 1.0 - lit / float(kernel * kernel);
 }
 
 void main()
 {   
-    vec3 normal = texture(normalMap, TexCoords).rgb;
-    normal = normal * 2.0 - 1.0;   
+    // only x and y are read, z is reconstructed: the normal map array is RGB8, or BC5 (which stores just x and y) when
+    // every normal map has a DDS file (see MaterialLibrary)
+    vec3 normal;
+    normal.xy = texture(normalMap, vec3(TexCoords, MaterialLayer)).rg * 2.0 - 1.0;
+    normal.z = sqrt(max(1.0 - dot(normal.xy, normal.xy), 0.0));
     normal.xy *= bumpiness;
     normal = normalize(TBN * normal); 
 
-    vec3 color = texture(diffuseTexture, TexCoords).rgb;
-    vec3 lightColor = vec3(1.0);
+    vec3 color = texture(diffuseTexture, vec3(TexCoords, MaterialLayer)).rgb;
 
     // ambient
     float ambientStrength = 0.3;
     vec3 ambient = ambientStrength * color;
 
-    vec3 lightDir = normalize(lightPos - FragPos);
+    vec3 lightDir = normalize(lightPos.xyz - FragPos);
     float diff = max(dot(lightDir, normal), 0.0);
-    vec3 diffuse = diff * lightColor;
+    vec3 diffuse = diff * lightColor.rgb;
 
-    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 viewDir = normalize(viewPos.xyz - FragPos);
     vec3 reflectDir = reflect(-lightDir, normal);
     vec3 halfwayDir = normalize(lightDir + viewDir);  
     float spec = pow(max(dot(normal, halfwayDir), 0.0), 64.0);
-    vec3 specular = spec * lightColor; 
+    vec3 specular = spec * lightColor.rgb; 
 
     // calculate shadow
-    float shadow = ShadowCalculation(FragPosLightSpace);       
+    float shadow = ShadowCalculation(FragPos);       
     vec3 lighting = (ambient + (1.0 - shadow) * (diffuse + specular)) * color; 
 
     FragColor = vec4(lighting, 1.0);
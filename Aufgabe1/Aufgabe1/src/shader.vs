@@ -1,28 +1,40 @@
 #version 330 core
+#define MAX_CASCADES 4
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 layout (location = 3) in vec3 aTangent;
+layout (location = 4) in mat4 aModel;
+// layer of the material in the texture arrays
+layout (location = 8) in int aMaterial;
 
 out vec2 TexCoords;
-out vec4 FragPosLightSpace;
 out vec3 FragPos;
 out vec3 Normal;
 out mat3 TBN;
+flat out int MaterialLayer;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform mat4 lightSpaceMatrix;
+// shared with all programs, has to match FrameUniforms in UniformBuffers.h
+layout (std140) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    mat4 lightSpaceMatrices[MAX_CASCADES];
+    vec4 viewPos;
+    int cascadeCount;
+    int shadowTaps;
+    float bumpiness;
+};
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = transpose(inverse(mat3(model))) * aNormal;
+    FragPos = vec3(aModel * vec4(aPos, 1.0));
+    Normal = transpose(inverse(mat3(aModel))) * aNormal;
     TexCoords = aTexCoords; 
-    FragPosLightSpace = lightSpaceMatrix * vec4(FragPos, 1.0);
+    MaterialLayer = aMaterial;
 
-    mat3 normalMatrix = transpose(inverse(mat3(model)));
+    mat3 normalMatrix = transpose(inverse(mat3(aModel)));
     vec3 T = normalize(normalMatrix * aTangent);
     vec3 N = normalize(normalMatrix * aNormal);
     T = normalize(T - dot(T, N) * N);
@@ -30,5 +42,5 @@ void main()
     
     TBN = mat3(T, B, N);
 
-    gl_Position = projection * view * model * vec4(FragPos, 1.0);
+    gl_Position = viewProjection * aModel * vec4(FragPos, 1.0);
 }
\ No newline at end of file
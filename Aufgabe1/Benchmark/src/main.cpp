@@ -0,0 +1,612 @@
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtx/quaternion.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Spline.h"
+#include "CameraPath.h"
+#include "PathBatch.h"
+#include "Culling.h"
+#include "SceneGenerator.h"
+#include "CpuProfiler.h"
+
+#include "stb_image.h"
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <random>
+
+// number of evaluations per round of a benchmark
+const int ITERATIONS = 200000;
+// every benchmark is run WARMUP_ROUNDS times untimed (caches, branch predictors, clock ramp up),
+// then `rounds` times timed, each timed round is one sample of the statistics
+const int WARMUP_ROUNDS = 2;
+int rounds = 10;
+
+// keeps the compiler from optimizing the benchmarked work away
+volatile float sink;
+
+// same camera path as the demo scene
+glm::vec3 pathPos[] = {
+	glm::vec3(0.0f,  5.0f,  -3.0f),
+	glm::vec3(1.0f,  3.0f,  -1.0f),
+	glm::vec3(2.0f,  3.0f,  1.0f),
+	glm::vec3(2.0f,  3.0f,  0.0f),
+	glm::vec3(4.0f,  3.0f,  4.0f),
+	glm::vec3(3.0f,  2.0f,  8.0f),
+	glm::vec3(2.0f,  1.0f,  10.0f),
+	glm::vec3(1.0f,  1.0f,  12.0f),
+	glm::vec3(4.0f,  0.0f,  14.0f),
+	glm::vec3(2.0f,  2.0f,  20.0f),
+	glm::vec3(0.0f,  3.0f,  14.0f),
+	glm::vec3(-2.0f,  5.0f,  12.0f),
+	glm::vec3(-2.0f,  4.0f,  10.0f),
+	glm::vec3(-2.0f,  3.0f,  8.0f),
+	glm::vec3(-2.0f,  2.0f,  6.0f),
+	glm::vec3(-2.0f,  0.0f,  4.0f),
+	glm::vec3(-2.0f,  0.0f,  2.0f),
+	glm::vec3(-2.0f,  0.0f,  0.0f),
+	glm::vec3(-2.0f,  0.0f,  -2.0f),
+	glm::vec3(-1.0f,  0.0f,  -2.0f)
+};
+
+glm::vec3 lookDir[] = {
+	glm::vec3(0.0f, 0.0f, 1.0f),
+	glm::vec3(1.0f, 0.0f, 1.0f),
+	glm::vec3(1.0f, 0.0f, 1.0f),
+	glm::vec3(0.3f, 0.0f, 1.0f),
+	glm::vec3(0.1f, 0.0f, 1.0f),
+	glm::vec3(0.1, 0, 0.7),
+	glm::vec3(0.3, 0, 0.5),
+	glm::vec3(-1, 0, -1),
+	glm::vec3(-0.4, 0, -0),
+	glm::vec3(-0.7, 0, -1),
+	glm::vec3(-1, 0, -1),
+	glm::vec3(-1, 0, -0.8),
+	glm::vec3(-1, 0, -0.5),
+	glm::vec3(-1, 0, -0.3),
+	glm::vec3(-1, 0, 0),
+	glm::vec3(-1, 0, 0.1),
+	glm::vec3(-1, 0, 0.5),
+	glm::vec3(-1, 0, 1),
+	glm::vec3(-1, 0, 1),
+	glm::vec3(0, 0, 1),
+};
+
+const int KEYS = sizeof(pathPos) / sizeof(pathPos[0]);
+
+// samples of one benchmark, sorted
+struct Result
+{
+	std::string name;
+	std::string unit;
+	std::vector<double> samples;
+
+	double median() const
+	{
+		size_t n = samples.size();
+		return n % 2 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) * 0.5;
+	}
+
+	double mean() const
+	{
+		double sum = 0.0;
+		for (double s : samples)
+			sum += s;
+		return sum / samples.size();
+	}
+
+	double stddev() const
+	{
+		double m = mean(), sum = 0.0;
+		for (double s : samples)
+			sum += (s - m) * (s - m);
+		return samples.size() > 1 ? std::sqrt(sum / (samples.size() - 1)) : 0.0;
+	}
+};
+
+// everything that was reported, for the JSON file
+std::vector<Result> results;
+
+// runs round() WARMUP_ROUNDS + rounds times, the timed rounds return one sample each
+template <typename F>
+std::vector<double> sampleRounds(F round)
+{
+	std::vector<double> samples;
+	for (int r = 0; r < WARMUP_ROUNDS + rounds; r++)
+	{
+		double sample = round();
+		if (r >= WARMUP_ROUNDS)
+			samples.push_back(sample);
+	}
+	return samples;
+}
+
+// runs f(i) for ITERATIONS iterations per round, the samples are the average time per call in nanoseconds
+template <typename F>
+std::vector<double> measure(F f)
+{
+	return sampleRounds([&]() {
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < ITERATIONS; i++)
+			f(i);
+		auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::nano>(end - start).count() / ITERATIONS;
+	});
+}
+
+// prints the median with mean, standard deviation and minimum, and keeps the samples for the JSON file
+void report(const char* name, std::vector<double> samples, const char* unit = "ns/eval")
+{
+	Result result;
+	result.name = name;
+	// without the indentation of the console output
+	result.name.erase(0, result.name.find_first_not_of(' '));
+	result.unit = unit;
+	result.samples = samples;
+	std::sort(result.samples.begin(), result.samples.end());
+	std::cout << name << ": " << result.median() << " " << unit << " (mean " << result.mean() << ", stddev " << result.stddev()
+		<< ", min " << result.samples.front() << ")" << std::endl;
+	results.push_back(result);
+}
+
+// all results with their statistics and raw samples
+bool writeJson(const std::string& path)
+{
+	std::ofstream out(path);
+	if (!out)
+		return false;
+	out << "{" << std::endl;
+	out << "  \"warmup_rounds\": " << WARMUP_ROUNDS << "," << std::endl;
+	out << "  \"rounds\": " << rounds << "," << std::endl;
+	out << "  \"benchmarks\": [" << std::endl;
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const Result& r = results[i];
+		out << "    { \"name\": \"" << r.name << "\", \"unit\": \"" << r.unit << "\", \"median\": " << r.median()
+			<< ", \"mean\": " << r.mean() << ", \"stddev\": " << r.stddev() << ", \"min\": " << r.samples.front()
+			<< ", \"max\": " << r.samples.back() << ", \"samples\": [";
+		for (size_t s = 0; s < r.samples.size(); s++)
+			out << (s ? ", " : "") << r.samples[s];
+		out << "] }" << (i + 1 < results.size() ? "," : "") << std::endl;
+	}
+	out << "  ]" << std::endl;
+	out << "}" << std::endl;
+	return true;
+}
+
+// samples for the batch benchmark
+const int BATCH_SAMPLES = 1000000;
+
+// SoA buffers for the batch evaluator
+struct SampleBuffers
+{
+	std::vector<float> data[7];
+
+	SampleBuffers(int n)
+	{
+		for (auto& d : data)
+			d.resize(n);
+	}
+
+	PathSamples samples()
+	{
+		PathSamples s = { data[0].data(), data[1].data(), data[2].data(), data[3].data(), data[4].data(), data[5].data(), data[6].data() };
+		return s;
+	}
+};
+
+// runs f once over all batch samples per round, the samples are nanoseconds per path sample
+template <typename F>
+std::vector<double> measureBatch(F f)
+{
+	return sampleRounds([&]() {
+		auto start = std::chrono::steady_clock::now();
+		f();
+		auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::nano>(end - start).count() / BATCH_SAMPLES;
+	});
+}
+
+// largest difference between the batch output and CameraPath::evaluate
+float maxBatchError(const CameraPath& path, const std::vector<int>& segments, const std::vector<float>& t, SampleBuffers& buffers)
+{
+	float error = 0.0f;
+	for (int i = 0; i < BATCH_SAMPLES; i++)
+	{
+		glm::vec3 position;
+		glm::quat orientation;
+		path.evaluate(segments[i], t[i], position, orientation);
+		error = std::max(error, glm::length(position - glm::vec3(buffers.data[0][i], buffers.data[1][i], buffers.data[2][i])));
+		error = std::max(error, glm::length(glm::vec4(orientation.w - buffers.data[3][i], orientation.x - buffers.data[4][i], orientation.y - buffers.data[5][i], orientation.z - buffers.data[6][i])));
+	}
+	return error;
+}
+
+// dense offline sampling: 1M samples per-sample vs. batched scalar vs. batched SIMD
+void benchmarkBatch(const CameraPath& cameraPath)
+{
+	int segmentCount = cameraPath.segmentCount();
+	std::vector<int> segments(BATCH_SAMPLES);
+	std::vector<float> t(BATCH_SAMPLES);
+	for (int i = 0; i < BATCH_SAMPLES; i++)
+	{
+		// contiguous runs per segment, like sub frame sampling along the path
+		segments[i] = (int)((long long)i * segmentCount / BATCH_SAMPLES);
+		t[i] = (float)((long long)i * segmentCount % BATCH_SAMPLES) / BATCH_SAMPLES;
+	}
+	SampleBuffers buffers(BATCH_SAMPLES);
+	PathSamples out = buffers.samples();
+
+	std::vector<double> single = measureBatch([&]() {
+		for (int i = 0; i < BATCH_SAMPLES; i++)
+		{
+			glm::vec3 position;
+			glm::quat orientation;
+			cameraPath.evaluate(segments[i], t[i], position, orientation);
+			out.px[i] = position.x; out.py[i] = position.y; out.pz[i] = position.z;
+			out.qw[i] = orientation.w; out.qx[i] = orientation.x; out.qy[i] = orientation.y; out.qz[i] = orientation.z;
+		}
+	});
+	std::vector<double> scalar = measureBatch([&]() { pathbatch::evaluate<pathbatch::ScalarOps>(cameraPath, segments.data(), t.data(), BATCH_SAMPLES, out); });
+	float scalarError = maxBatchError(cameraPath, segments, t, buffers);
+	std::vector<double> simd = measureBatch([&]() { evaluateBatch(cameraPath, segments.data(), t.data(), BATCH_SAMPLES, out); });
+	float simdError = maxBatchError(cameraPath, segments, t, buffers);
+	std::vector<double> oneSegment = measureBatch([&]() { evaluateSegmentBatch(cameraPath, 0, t.data(), BATCH_SAMPLES, out); });
+
+	std::cout << "batch of " << BATCH_SAMPLES << " samples, " << pathbatch::BestOps::width << " lanes" << std::endl;
+	report("  CameraPath::evaluate per sample", single, "ns/sample");
+	report("  evaluateBatch scalar", scalar, "ns/sample");
+	report("  evaluateBatch SIMD", simd, "ns/sample");
+	report("  evaluateSegmentBatch SIMD (one segment)", oneSegment, "ns/sample");
+	std::cout << "  max error scalar " << scalarError << ", SIMD " << simdError << std::endl;
+}
+
+// boxes for the culling benchmark and frames the camera takes along the path
+const int CULL_BOXES = 1000000;
+const int CULL_FRAMES = 100;
+// frames culled per round, each round continues along the path where the last one stopped
+const int CULL_FRAMES_PER_ROUND = 10;
+
+// light space matrix of an ortho light looking along lightDir that covers the view frustum,
+// extended towards the light so casters in front of it are kept (one cascade over the whole frustum)
+glm::mat4 fitLight(const glm::mat4& viewProjection, const glm::vec3& lightDir)
+{
+	glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), lightDir, glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 toLight = lightView * glm::inverse(viewProjection);
+	glm::vec3 min(1e30f), max(-1e30f);
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec4 corner = toLight * glm::vec4(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f, 1.0f);
+		glm::vec3 p = glm::vec3(corner) / corner.w;
+		min = glm::min(min, p);
+		max = glm::max(max, p);
+	}
+	return glm::ortho(min.x, max.x, min.y, max.y, -max.z - 200.0f, -min.z) * lightView;
+}
+
+// 1M boxes scattered around the path, culled against the camera and the light every frame
+void benchmarkCulling(const CameraPath& cameraPath)
+{
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+	std::uniform_real_distribution<float> height(-2.0f, 20.0f);
+	std::uniform_real_distribution<float> size(0.5f, 3.0f);
+	Culler culler;
+	for (int i = 0; i < CULL_BOXES; i++)
+	{
+		glm::vec3 center(position(random), height(random), position(random));
+		glm::vec3 half(size(random) * 0.5f);
+		culler.add(center - half, center + half);
+	}
+
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+	glm::vec3 lightDir = glm::normalize(glm::vec3(0.0f, 0.0f, 5.0f) - glm::vec3(20.0f, 100.0f, 120.0f));
+	std::vector<Frustum> cameras(CULL_FRAMES), lights(CULL_FRAMES);
+	for (int f = 0; f < CULL_FRAMES; f++)
+	{
+		glm::vec3 movePoint;
+		glm::quat lookQuat;
+		cameraPath.sample(cameraPath.length() * f / CULL_FRAMES, movePoint, lookQuat);
+		glm::mat4 viewProjection = projection * glm::lookAt(movePoint, movePoint + lookQuat * glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		cameras[f] = Frustum(viewProjection);
+		lights[f] = Frustum(fitLight(viewProjection, lightDir));
+	}
+
+	std::vector<uint8_t> visible;
+	size_t cameraVisible = 0, lightVisible = 0, scalarVisible = 0;
+	int frame = 0;
+	std::vector<double> simd = sampleRounds([&]() {
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < CULL_FRAMES_PER_ROUND; i++, frame++)
+		{
+			cameraVisible += culler.cull(cameras[frame % CULL_FRAMES], visible);
+			lightVisible += culler.cull(lights[frame % CULL_FRAMES], visible);
+		}
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / CULL_FRAMES_PER_ROUND;
+	});
+	int frames = frame;
+	frame = 0;
+	std::vector<double> scalar = sampleRounds([&]() {
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < CULL_FRAMES_PER_ROUND; i++, frame++)
+		{
+			scalarVisible += culler.cullScalar(&cameras[frame % CULL_FRAMES], 1, visible);
+			scalarVisible += culler.cullScalar(&lights[frame % CULL_FRAMES], 1, visible);
+		}
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / CULL_FRAMES_PER_ROUND;
+	});
+
+	double draws = 2.0 * CULL_BOXES;
+	double kept = (double)(cameraVisible + lightVisible) / frames;
+	std::cout << "culling " << CULL_BOXES << " boxes against camera and light, " << Culler::BLOCK << " per test" << std::endl;
+	report("  Culler::cull SIMD", simd, "ms/frame");
+	report("  Culler::cullScalar", scalar, "ms/frame");
+	if (scalarVisible != cameraVisible + lightVisible)
+		std::cout << "  SIMD and scalar results differ!" << std::endl;
+	std::cout << "  camera " << (double)cameraVisible / frames << ", light " << (double)lightVisible / frames << " boxes visible per frame" << std::endl;
+	std::cout << "  draws per frame " << draws << " -> " << kept << " (" << 100.0 * (1.0 - kept / draws) << "% less)" << std::endl;
+}
+
+// cubes of the generated stress scene for the model matrix benchmark, like "--scene clusters --scene-count 100000"
+const int SCENE_CUBES = 100000;
+
+// model matrices and bounds of every scene object, what the scene setup does per object
+// (and what renderScene did for every cube every frame)
+void benchmarkModelMatrices()
+{
+	SceneGenerator generator(1);
+	GeneratedScene scene = generator.generate(SCENE_CLUSTERS, SCENE_CUBES);
+	int count = (int)scene.cubes.size();
+	std::vector<glm::mat4> models(count);
+	std::vector<glm::vec3> boundsMin(count), boundsMax(count);
+	glm::vec3 cubeMin(-0.5f), cubeMax(0.5f);
+
+	std::vector<double> translate = sampleRounds([&]() {
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < count; i++)
+			models[i] = glm::translate(glm::mat4(1.0f), scene.cubes[i]);
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+	});
+	std::vector<double> bounds = sampleRounds([&]() {
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < count; i++)
+		{
+			// caster bounds with the model matrix, camera bounds with it applied twice (see shader.vs)
+			transformBounds(models[i], cubeMin, cubeMax, boundsMin[i], boundsMax[i]);
+			transformBounds(models[i] * models[i], cubeMin, cubeMax, boundsMin[i], boundsMax[i]);
+		}
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+	});
+	sink = models[count / 2][3][0] + boundsMax[count / 2].x;
+
+	std::cout << "scene of " << count << " cubes" << std::endl;
+	report("  model matrix (translate)", translate, "ns/object");
+	report("  caster and camera bounds", bounds, "ns/object");
+}
+
+// the per frame camera setup of the render loop: view from the sampled path, projection, view projection and its frustum
+void benchmarkCamera(const CameraPath& cameraPath)
+{
+	const int CAMERA_SAMPLES = 1024;
+	std::vector<glm::vec3> positions(CAMERA_SAMPLES);
+	std::vector<glm::quat> orientations(CAMERA_SAMPLES);
+	for (int i = 0; i < CAMERA_SAMPLES; i++)
+		cameraPath.sample(cameraPath.length() * i / CAMERA_SAMPLES, positions[i], orientations[i]);
+	float aspect = 800.0f / 600.0f;
+
+	std::vector<double> viewProjection = measure([&](int i) {
+		int c = i % CAMERA_SAMPLES;
+		glm::mat4 view = glm::lookAt(positions[c], positions[c] + orientations[c] * glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::mat4 projection = glm::perspective(glm::radians(45.0f), aspect, 0.1f, 100.0f);
+		sink = (projection * view)[3][2];
+	});
+	std::vector<double> frustum = measure([&](int i) {
+		int c = i % CAMERA_SAMPLES;
+		glm::mat4 view = glm::lookAt(positions[c], positions[c] + orientations[c] * glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::mat4 projection = glm::perspective(glm::radians(45.0f), aspect, 0.1f, 100.0f);
+		sink = Frustum(projection * view).planes[5].w;
+	});
+
+	report("lookAt + perspective + view projection", viewProjection);
+	report("lookAt + perspective + view projection + frustum planes", frustum);
+}
+
+// decode of the textures loadTexture uses, from memory (decode only) and with stbi_load (file read and decode)
+void benchmarkTextures(const std::string& directory)
+{
+	const char* files[] = { "brickwall.jpg", "brickwall_normal.jpg" };
+	for (const char* file : files)
+	{
+		std::string path = directory + file;
+		std::ifstream in(path, std::ios::binary);
+		std::vector<unsigned char> encoded((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		int width = 0, height = 0, components = 0;
+		if (encoded.empty() || !stbi_info_from_memory(encoded.data(), (int)encoded.size(), &width, &height, &components))
+		{
+			std::cout << "texture " << path << " not found, skipped (set the directory with --textures)" << std::endl;
+			continue;
+		}
+
+		std::vector<double> decode = sampleRounds([&]() {
+			auto start = std::chrono::steady_clock::now();
+			int w, h, n;
+			unsigned char* data = stbi_load_from_memory(encoded.data(), (int)encoded.size(), &w, &h, &n, 0);
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			stbi_image_free(data);
+			return ms;
+		});
+		std::vector<double> load = sampleRounds([&]() {
+			auto start = std::chrono::steady_clock::now();
+			int w, h, n;
+			unsigned char* data = stbi_load(path.c_str(), &w, &h, &n, 0);
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			stbi_image_free(data);
+			return ms;
+		});
+
+		std::cout << file << ": " << width << "x" << height << ", " << components << " channels, " << encoded.size() / 1024 << " KiB" << std::endl;
+		report((std::string("  stbi_load_from_memory ") + file).c_str(), decode, "ms/image");
+		report((std::string("  stbi_load ") + file).c_str(), load, "ms/image");
+	}
+}
+
+#ifdef EZG_PROFILE
+// cost of one PROFILE_ZONE (two time stamp counter reads and the push into the ring of the thread), the target is below 50 ns.
+// There is no flush thread, the benchmark empties the ring itself every CHUNK zones so none is dropped.
+const double PROFILE_ZONE_TARGET = 50.0;
+
+void benchmarkProfileZone()
+{
+	cpuprofiler::ThreadBuffer& buffer = cpuprofiler::threadBuffer();
+	const int CHUNK = cpuprofiler::ThreadBuffer::CAPACITY / 2;
+
+	std::vector<double> clock = measure([&](int) {
+		sink = (float)cpuprofiler::now();
+	});
+	std::vector<double> zone = sampleRounds([&]() {
+		auto start = std::chrono::steady_clock::now();
+		for (int first = 0; first < ITERATIONS; first += CHUNK)
+		{
+			int last = std::min(first + CHUNK, ITERATIONS);
+			for (int i = first; i < last; i++)
+			{
+				PROFILE_ZONE("benchmark");
+				sink = (float)i;
+			}
+			buffer.tail.store(buffer.head.load(std::memory_order_acquire), std::memory_order_release);
+		}
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ITERATIONS;
+	});
+
+	report("cpuprofiler::now", clock, "ns/call");
+	report("PROFILE_ZONE", zone, "ns/zone");
+	double perZone = results.back().median();
+	std::cout << "  " << perZone << " ns per zone, " << (perZone < PROFILE_ZONE_TARGET ? "below" : "above") << " the target of "
+		<< PROFILE_ZONE_TARGET << " ns" << std::endl;
+	if (buffer.dropped.load() > 0)
+		std::cout << "  " << buffer.dropped.load() << " zones dropped, the result is too low" << std::endl;
+}
+#endif
+
+void printUsage()
+{
+	std::cout << "Usage: Benchmark.exe --json [output file] --rounds [timed rounds] --textures [directory of brickwall.jpg]" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	std::string jsonFile;
+	std::string textureDirectory = "../Aufgabe1/src/";
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (i + 1 >= argc || (arg != "--json" && arg != "--rounds" && arg != "--textures")) {
+			printUsage();
+			return 1;
+		}
+		if (arg == "--json")
+			jsonFile = argv[i + 1];
+		if (arg == "--rounds")
+			rounds = std::max(1, std::stoi(argv[i + 1]));
+		if (arg == "--textures") {
+			textureDirectory = argv[i + 1];
+			if (textureDirectory.back() != '/' && textureDirectory.back() != '\\')
+				textureDirectory += '/';
+		}
+		i++;
+	}
+
+	glm::quat lookDirQuaternions[KEYS];
+	glm::vec3 initialOrientation = glm::vec3(0.0f, 0.0f, -1.0f);
+	for (int i = 0; i < KEYS; i++)
+		lookDirQuaternions[i] = glm::rotation(glm::normalize(initialOrientation), glm::normalize(lookDir[i]));
+
+	CameraPath cameraPath(pathPos, lookDirQuaternions, KEYS);
+	int segments = cameraPath.segmentCount();
+
+	// the pieces of the old per frame evaluation on their own
+	std::vector<double> tangents = measure([&](int i) {
+		int index = 1 + i % segments;
+		glm::vec3 tang1, tang2;
+		calcTangents(pathPos[index - 1], pathPos[index], pathPos[index + 1], pathPos[index + 2], tang1, tang2);
+		sink = tang1.x + tang2.x;
+	});
+	// with the tangents of the segment, computed up front so only calcPoint is timed
+	std::vector<glm::vec3> segmentTangents(2 * (segments + 1));
+	for (int index = 1; index <= segments; index++)
+		calcTangents(pathPos[index - 1], pathPos[index], pathPos[index + 1], pathPos[index + 2], segmentTangents[2 * index], segmentTangents[2 * index + 1]);
+	std::vector<double> point = measure([&](int i) {
+		int index = 1 + i % segments;
+		sink = calcPoint((i % 200) / 200.0f, pathPos[index], pathPos[index + 1], segmentTangents[2 * index], segmentTangents[2 * index + 1]).x;
+	});
+	std::vector<double> squad = measure([&](int i) {
+		int index = 1 + i % segments;
+		glm::quat helpQuat1 = glm::intermediate(lookDirQuaternions[index - 1], lookDirQuaternions[index], lookDirQuaternions[index + 1]);
+		glm::quat helpQuat2 = glm::intermediate(lookDirQuaternions[index], lookDirQuaternions[index + 1], lookDirQuaternions[index + 2]);
+		sink = glm::squad(lookDirQuaternions[index], lookDirQuaternions[index + 1], helpQuat1, helpQuat2, (i % 200) / 200.0f).w;
+	});
+
+	// old per frame evaluation: tangents and helper quats rebuilt for every evaluation
+	std::vector<double> legacy = measure([&](int i) {
+		int index = 1 + i % segments;
+		float t = (i % 200) / 200.0f;
+		std::vector<glm::vec3> tangents = calcTangents(pathPos[index - 1], pathPos[index], pathPos[index + 1], pathPos[index + 2]);
+		glm::quat helpQuat1 = glm::intermediate(lookDirQuaternions[index - 1], lookDirQuaternions[index], lookDirQuaternions[index + 1]);
+		glm::quat helpQuat2 = glm::intermediate(lookDirQuaternions[index], lookDirQuaternions[index + 1], lookDirQuaternions[index + 2]);
+		glm::vec3 movePoint = calcPoint(t, pathPos[index], pathPos[index + 1], tangents[0], tangents[1]);
+		glm::quat lookQuat = glm::squad(lookDirQuaternions[index], lookDirQuaternions[index + 1], helpQuat1, helpQuat2, t);
+		sink = movePoint.x + lookQuat.w;
+	});
+
+	// cached coefficients and control quaternions
+	std::vector<double> cached = measure([&](int i) {
+		glm::vec3 movePoint;
+		glm::quat lookQuat;
+		cameraPath.evaluate(i % segments, (i % 200) / 200.0f, movePoint, lookQuat);
+		sink = movePoint.x + lookQuat.w;
+	});
+
+	// cached coefficients, position only
+	std::vector<double> positionOnly = measure([&](int i) {
+		sink = cameraPath.evaluatePosition(i % segments, (i % 200) / 200.0f).x;
+	});
+
+	// arc length lookup plus evaluation, what the render loop does per simulation step
+	float step = cameraPath.length() / ITERATIONS;
+	std::vector<double> byDistance = measure([&](int i) {
+		glm::vec3 movePoint;
+		glm::quat lookQuat;
+		cameraPath.sample(i * step, movePoint, lookQuat);
+		sink = movePoint.x + lookQuat.w;
+	});
+
+	report("calcTangents", tangents);
+	report("calcPoint", point);
+	report("2x intermediate + squad", squad);
+	report("calcTangents + intermediate + calcPoint + squad", legacy);
+	report("CameraPath::evaluate", cached);
+	report("CameraPath::evaluatePosition", positionOnly);
+	report("CameraPath::sample (arc length)", byDistance);
+
+	benchmarkBatch(cameraPath);
+	benchmarkCulling(cameraPath);
+	benchmarkModelMatrices();
+	benchmarkCamera(cameraPath);
+	benchmarkTextures(textureDirectory);
+#ifdef EZG_PROFILE
+	benchmarkProfileZone();
+#else
+	std::cout << "PROFILE_ZONE skipped, EZG_PROFILE is not defined" << std::endl;
+#endif
+
+	if (!jsonFile.empty() && !writeJson(jsonFile)) {
+		std::cout << "Failed to write " << jsonFile << std::endl;
+		return 1;
+	}
+	return 0;
+}
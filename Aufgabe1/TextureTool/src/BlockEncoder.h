@@ -0,0 +1,280 @@
+#ifndef BLOCKENCODER_H
+#define BLOCKENCODER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BLOCKENCODER_SSE
+#endif
+
+// Encoders (and decoders, to measure the error) for single 4x4 blocks of RGBA8 pixels, 16 pixels row by row.
+// BC1 color: endpoints at the ends of the principal axis of the block colors, refined once by least squares,
+// always the 4 color mode. BC4 channel (BC3 alpha, both halves of BC5): minimum and maximum of the channel
+// with the 8 value palette. The indices of all 16 pixels come from projecting them onto the endpoint axis,
+// 4 pixels per instruction with SSE2, plain floats otherwise.
+
+namespace bc
+{
+	struct Color
+	{
+		float r, g, b;
+	};
+
+	// 5:6:5 with rounding, and back to 0-255 the way the hardware expands it
+	inline uint16_t pack565(const Color& c)
+	{
+		int r = std::min(31, std::max(0, (int)(c.r * 31.0f / 255.0f + 0.5f)));
+		int g = std::min(63, std::max(0, (int)(c.g * 63.0f / 255.0f + 0.5f)));
+		int b = std::min(31, std::max(0, (int)(c.b * 31.0f / 255.0f + 0.5f)));
+		return (uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	inline Color unpack565(uint16_t v)
+	{
+		int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+		Color c = { (float)((r << 3) | (r >> 2)), (float)((g << 2) | (g >> 4)), (float)((b << 3) | (b >> 2)) };
+		return c;
+	}
+
+	// steps[i] = round(clamp(dot(p - origin, axis) * scale, 0, 1) * maxStep) for the 16 pixels given as SoA
+	inline void project(const float* x, const float* y, const float* z, const float origin[3], const float axis[3], float scale, float maxStep, int steps[16])
+	{
+#ifdef BLOCKENCODER_SSE
+		__m128 ox = _mm_set1_ps(origin[0]), oy = _mm_set1_ps(origin[1]), oz = _mm_set1_ps(origin[2]);
+		__m128 ax = _mm_set1_ps(axis[0] * scale * maxStep), ay = _mm_set1_ps(axis[1] * scale * maxStep), az = _mm_set1_ps(axis[2] * scale * maxStep);
+		__m128 zero = _mm_setzero_ps(), top = _mm_set1_ps(maxStep);
+		for (int i = 0; i < 16; i += 4)
+		{
+			__m128 t = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(x + i), ox), ax),
+				_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(y + i), oy), ay)), _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(z + i), oz), az));
+			t = _mm_min_ps(_mm_max_ps(t, zero), top);
+			// round to nearest (the value is not negative)
+			_mm_storeu_si128((__m128i*)(steps + i), _mm_cvttps_epi32(_mm_add_ps(t, _mm_set1_ps(0.5f))));
+		}
+#else
+		for (int i = 0; i < 16; i++)
+		{
+			float t = ((x[i] - origin[0]) * axis[0] + (y[i] - origin[1]) * axis[1] + (z[i] - origin[2]) * axis[2]) * scale * maxStep;
+			steps[i] = (int)(std::min(std::max(t, 0.0f), maxStep) + 0.5f);
+		}
+#endif
+	}
+
+	// squared error of the block against the 4 color palette of the endpoints
+	inline float paletteError(const float* r, const float* g, const float* b, uint16_t c0, uint16_t c1, const int steps[16])
+	{
+		Color e0 = unpack565(c0), e1 = unpack565(c1);
+		float error = 0.0f;
+		for (int i = 0; i < 16; i++)
+		{
+			float w = steps[i] / 3.0f;
+			float dr = r[i] - (e0.r + (e1.r - e0.r) * w), dg = g[i] - (e0.g + (e1.g - e0.g) * w), db = b[i] - (e0.b + (e1.b - e0.b) * w);
+			error += dr * dr + dg * dg + db * db;
+		}
+		return error;
+	}
+
+	// steps 0-3 from e0 to e1 for the pixels, nearest on the axis of the quantized endpoints
+	inline void colorSteps(const float* r, const float* g, const float* b, uint16_t c0, uint16_t c1, int steps[16])
+	{
+		Color e0 = unpack565(c0), e1 = unpack565(c1);
+		float origin[3] = { e0.r, e0.g, e0.b };
+		float axis[3] = { e1.r - e0.r, e1.g - e0.g, e1.b - e0.b };
+		float length2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+		project(r, g, b, origin, axis, length2 > 0.0f ? 1.0f / length2 : 0.0f, 3.0f, steps);
+	}
+
+	// least squares endpoints for the given steps, false if all pixels use the same step
+	inline bool fitEndpoints(const float* r, const float* g, const float* b, const int steps[16], Color& e0, Color& e1)
+	{
+		float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+		Color x = { 0.0f, 0.0f, 0.0f }, y = { 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < 16; i++)
+		{
+			float beta = steps[i] / 3.0f, alpha = 1.0f - beta;
+			aa += alpha * alpha;
+			bb += beta * beta;
+			ab += alpha * beta;
+			x.r += alpha * r[i]; x.g += alpha * g[i]; x.b += alpha * b[i];
+			y.r += beta * r[i]; y.g += beta * g[i]; y.b += beta * b[i];
+		}
+		float det = aa * bb - ab * ab;
+		if (std::fabs(det) < 1e-6f)
+			return false;
+		float f = 1.0f / det;
+		e0 = { (x.r * bb - y.r * ab) * f, (x.g * bb - y.g * ab) * f, (x.b * bb - y.b * ab) * f };
+		e1 = { (y.r * aa - x.r * ab) * f, (y.g * aa - x.g * ab) * f, (y.b * aa - x.b * ab) * f };
+		return true;
+	}
+
+	// 8 bytes: two 565 endpoints and 2 bit indices
+	inline void encodeBC1(const uint8_t* rgba, uint8_t* out)
+	{
+		float r[16], g[16], b[16];
+		Color mean = { 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < 16; i++)
+		{
+			r[i] = rgba[i * 4];
+			g[i] = rgba[i * 4 + 1];
+			b[i] = rgba[i * 4 + 2];
+			mean.r += r[i]; mean.g += g[i]; mean.b += b[i];
+		}
+		mean.r /= 16.0f; mean.g /= 16.0f; mean.b /= 16.0f;
+
+		// principal axis of the colors by power iteration on the covariance
+		float cov[6] = { 0, 0, 0, 0, 0, 0 };
+		for (int i = 0; i < 16; i++)
+		{
+			float dr = r[i] - mean.r, dg = g[i] - mean.g, db = b[i] - mean.b;
+			cov[0] += dr * dr; cov[1] += dr * dg; cov[2] += dr * db;
+			cov[3] += dg * dg; cov[4] += dg * db; cov[5] += db * db;
+		}
+		float axis[3] = { 1.0f, 1.0f, 1.0f };
+		for (int iteration = 0; iteration < 4; iteration++)
+		{
+			float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+			float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+			float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+			float m = std::max(std::fabs(x), std::max(std::fabs(y), std::fabs(z)));
+			if (m == 0.0f)
+				break;
+			axis[0] = x / m; axis[1] = y / m; axis[2] = z / m;
+		}
+
+		// ends of the colors along the axis
+		float tMin = 1e30f, tMax = -1e30f;
+		for (int i = 0; i < 16; i++)
+		{
+			float t = (r[i] - mean.r) * axis[0] + (g[i] - mean.g) * axis[1] + (b[i] - mean.b) * axis[2];
+			tMin = std::min(tMin, t);
+			tMax = std::max(tMax, t);
+		}
+		float length2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+		tMin /= length2;
+		tMax /= length2;
+		Color e0 = { mean.r + axis[0] * tMax, mean.g + axis[1] * tMax, mean.b + axis[2] * tMax };
+		Color e1 = { mean.r + axis[0] * tMin, mean.g + axis[1] * tMin, mean.b + axis[2] * tMin };
+
+		uint16_t c0 = pack565(e0), c1 = pack565(e1);
+		int steps[16];
+		colorSteps(r, g, b, c0, c1, steps);
+		float error = paletteError(r, g, b, c0, c1, steps);
+
+		// one least squares refinement of the endpoints, kept if it lowers the error
+		Color f0, f1;
+		if (fitEndpoints(r, g, b, steps, f0, f1))
+		{
+			uint16_t d0 = pack565(f0), d1 = pack565(f1);
+			int refined[16];
+			colorSteps(r, g, b, d0, d1, refined);
+			float refinedError = paletteError(r, g, b, d0, d1, refined);
+			if (refinedError < error)
+			{
+				c0 = d0;
+				c1 = d1;
+				std::memcpy(steps, refined, sizeof(steps));
+			}
+		}
+
+		// the 4 color mode needs c0 > c1: swap the endpoints and walk the steps the other way
+		if (c0 < c1)
+		{
+			std::swap(c0, c1);
+			for (int i = 0; i < 16; i++)
+				steps[i] = 3 - steps[i];
+		}
+		// step 0 is c0, 3 is c1, 1 and 2 are the interpolated colors 2 and 3
+		static const uint32_t code[4] = { 0, 2, 3, 1 };
+		uint32_t indices = 0;
+		for (int i = 0; i < 16; i++)
+			indices |= (c0 == c1 ? 0 : code[steps[i]]) << (2 * i);
+
+		out[0] = (uint8_t)(c0 & 0xff); out[1] = (uint8_t)(c0 >> 8);
+		out[2] = (uint8_t)(c1 & 0xff); out[3] = (uint8_t)(c1 >> 8);
+		out[4] = (uint8_t)indices; out[5] = (uint8_t)(indices >> 8); out[6] = (uint8_t)(indices >> 16); out[7] = (uint8_t)(indices >> 24);
+	}
+
+	// 8 bytes: two 8 bit endpoints and 3 bit indices for one channel (0 = red ... 3 = alpha) of the block
+	inline void encodeBC4(const uint8_t* rgba, int channel, uint8_t* out)
+	{
+		float v[16], zero[16] = {};
+		int lo = 255, hi = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			int value = rgba[i * 4 + channel];
+			v[i] = (float)value;
+			lo = std::min(lo, value);
+			hi = std::max(hi, value);
+		}
+		// a0 > a1 selects the 8 value palette: a0, a1 and 6 values in between
+		int steps[16] = {};
+		if (hi > lo)
+		{
+			float origin[3] = { (float)hi, 0.0f, 0.0f };
+			float axis[3] = { -1.0f, 0.0f, 0.0f };
+			project(v, zero, zero, origin, axis, 1.0f / (hi - lo), 7.0f, steps);
+		}
+		// step 0 is a0, 7 is a1, the ones between are codes 2-7
+		uint64_t indices = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			uint64_t code = steps[i] == 0 ? 0 : steps[i] == 7 ? 1 : steps[i] + 1;
+			indices |= code << (3 * i);
+		}
+		out[0] = (uint8_t)hi;
+		out[1] = (uint8_t)lo;
+		for (int i = 0; i < 6; i++)
+			out[2 + i] = (uint8_t)(indices >> (8 * i));
+	}
+
+	// 16 bytes: BC4 alpha and BC1 color
+	inline void encodeBC3(const uint8_t* rgba, uint8_t* out)
+	{
+		encodeBC4(rgba, 3, out);
+		encodeBC1(rgba, out + 8);
+	}
+
+	// 16 bytes: BC4 of red and of green
+	inline void encodeBC5(const uint8_t* rgba, uint8_t* out)
+	{
+		encodeBC4(rgba, 0, out);
+		encodeBC4(rgba, 1, out + 8);
+	}
+
+	// writes the decoded channels into rgba (4 colors, alpha untouched)
+	inline void decodeBC1(const uint8_t* block, uint8_t* rgba)
+	{
+		uint16_t c0 = (uint16_t)(block[0] | (block[1] << 8)), c1 = (uint16_t)(block[2] | (block[3] << 8));
+		Color e0 = unpack565(c0), e1 = unpack565(c1);
+		Color palette[4] = { e0, e1,
+			{ (2 * e0.r + e1.r) / 3, (2 * e0.g + e1.g) / 3, (2 * e0.b + e1.b) / 3 },
+			{ (e0.r + 2 * e1.r) / 3, (e0.g + 2 * e1.g) / 3, (e0.b + 2 * e1.b) / 3 } };
+		uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((uint32_t)block[7] << 24);
+		for (int i = 0; i < 16; i++)
+		{
+			const Color& c = palette[(indices >> (2 * i)) & 3];
+			rgba[i * 4] = (uint8_t)(c.r + 0.5f);
+			rgba[i * 4 + 1] = (uint8_t)(c.g + 0.5f);
+			rgba[i * 4 + 2] = (uint8_t)(c.b + 0.5f);
+		}
+	}
+
+	inline void decodeBC4(const uint8_t* block, int channel, uint8_t* rgba)
+	{
+		int a0 = block[0], a1 = block[1];
+		int palette[8] = { a0, a1 };
+		for (int k = 1; k < 7; k++)
+			palette[k + 1] = a0 > a1 ? ((7 - k) * a0 + k * a1 + 3) / 7 : k < 5 ? ((5 - k) * a0 + k * a1 + 2) / 5 : (k == 5 ? 0 : 255);
+		uint64_t indices = 0;
+		for (int i = 0; i < 6; i++)
+			indices |= (uint64_t)block[2 + i] << (8 * i);
+		for (int i = 0; i < 16; i++)
+			rgba[i * 4 + channel] = (uint8_t)palette[(indices >> (3 * i)) & 7];
+	}
+}
+
+#endif
@@ -0,0 +1,201 @@
+#include "stb_image.h"
+
+#include "DdsFile.h"
+#include "MipGenerator.h"
+#include "BlockEncoder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Converts an image (jpg, png, ...) into a block compressed DDS file with a full mip chain:
+// BC1 for color, BC3 if the image has alpha, BC5 for normal maps (only x and y are stored, shader.fs
+// reconstructs z). The output goes next to the input with the extension .dds, where the TextureLoader looks for it.
+
+// one mip level as RGBA8
+struct Level
+{
+	int width = 0;
+	int height = 0;
+	std::vector<uint8_t> rgba;
+};
+
+// the 4x4 block at (bx, by), pixels outside the image repeat the border
+void fetchBlock(const Level& level, int bx, int by, uint8_t block[64])
+{
+	for (int y = 0; y < 4; y++)
+	{
+		for (int x = 0; x < 4; x++)
+		{
+			int sx = std::min(level.width - 1, bx * 4 + x), sy = std::min(level.height - 1, by * 4 + y);
+			std::memcpy(block + (y * 4 + x) * 4, &level.rgba[((size_t)sy * level.width + sx) * 4], 4);
+		}
+	}
+}
+
+// encodes the level into out, the rows of blocks are split between the threads
+void encodeLevel(const Level& level, BlockFormat format, uint8_t* out, int threads)
+{
+	int blocksX = (level.width + 3) / 4, blocksY = (level.height + 3) / 4;
+	int blockBytes = CompressedImage::blockBytes(format);
+	auto encodeRows = [&](int first, int last) {
+		uint8_t block[64];
+		for (int by = first; by < last; by++)
+		{
+			for (int bx = 0; bx < blocksX; bx++)
+			{
+				fetchBlock(level, bx, by, block);
+				uint8_t* target = out + ((size_t)by * blocksX + bx) * blockBytes;
+				if (format == FORMAT_BC1)
+					bc::encodeBC1(block, target);
+				else if (format == FORMAT_BC3)
+					bc::encodeBC3(block, target);
+				else
+					bc::encodeBC5(block, target);
+			}
+		}
+	};
+	threads = std::max(1, std::min(threads, blocksY));
+	std::vector<std::thread> workers;
+	for (int t = 1; t < threads; t++)
+		workers.emplace_back(encodeRows, blocksY * t / threads, blocksY * (t + 1) / threads);
+	encodeRows(0, blocksY / threads);
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+// root mean square error per channel of the encoded level 0 (only the channels the format stores)
+double encodingError(const Level& level, BlockFormat format, const uint8_t* encoded)
+{
+	int blocksX = (level.width + 3) / 4, blocksY = (level.height + 3) / 4;
+	int blockBytes = CompressedImage::blockBytes(format);
+	int first = 0, last = format == FORMAT_BC5 ? 2 : format == FORMAT_BC3 ? 4 : 3;
+	double sum = 0.0;
+	size_t count = 0;
+	uint8_t original[64], decoded[64];
+	for (int by = 0; by < blocksY; by++)
+	{
+		for (int bx = 0; bx < blocksX; bx++)
+		{
+			fetchBlock(level, bx, by, original);
+			const uint8_t* block = encoded + ((size_t)by * blocksX + bx) * blockBytes;
+			if (format == FORMAT_BC1)
+				bc::decodeBC1(block, decoded);
+			else if (format == FORMAT_BC3)
+			{
+				bc::decodeBC4(block, 3, decoded);
+				bc::decodeBC1(block + 8, decoded);
+			}
+			else
+			{
+				bc::decodeBC4(block, 0, decoded);
+				bc::decodeBC4(block + 8, 1, decoded);
+			}
+			for (int i = 0; i < 16; i++)
+			{
+				for (int c = first; c < last; c++)
+				{
+					double d = (double)original[i * 4 + c] - decoded[i * 4 + c];
+					sum += d * d;
+				}
+			}
+			count += 16 * (last - first);
+		}
+	}
+	return std::sqrt(sum / count);
+}
+
+void printUsage()
+{
+	std::cout << "Usage: TextureTool.exe [--bc1|--bc3|--normal] --threads [count] [input image] [output dds]" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	std::string input, output;
+	int forcedFormat = -1;
+	int threads = std::max(1, (int)std::thread::hardware_concurrency());
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--bc1")
+			forcedFormat = FORMAT_BC1;
+		else if (arg == "--bc3")
+			forcedFormat = FORMAT_BC3;
+		else if (arg == "--normal" || arg == "--bc5")
+			forcedFormat = FORMAT_BC5;
+		else if (arg == "--threads" && i + 1 < argc)
+			threads = std::max(1, std::stoi(argv[++i]));
+		else if (input.empty() && arg[0] != '-')
+			input = arg;
+		else if (output.empty() && arg[0] != '-')
+			output = arg;
+		else {
+			printUsage();
+			return 1;
+		}
+	}
+	if (input.empty()) {
+		printUsage();
+		return 1;
+	}
+	if (output.empty())
+		output = input.substr(0, input.find_last_of('.')) + ".dds";
+
+	Level base;
+	int components;
+	unsigned char* data = stbi_load(input.c_str(), &base.width, &base.height, &components, 4);
+	if (data == nullptr) {
+		std::cout << "Failed to load " << input << ": " << stbi_failure_reason() << std::endl;
+		return 1;
+	}
+	base.rgba.assign(data, data + (size_t)base.width * base.height * 4);
+	stbi_image_free(data);
+
+	BlockFormat format = FORMAT_BC1;
+	if (forcedFormat >= 0)
+		format = (BlockFormat)forcedFormat;
+	else if (components == 4 || components == 2)
+		format = FORMAT_BC3;
+
+	auto start = std::chrono::steady_clock::now();
+	CompressedImage image;
+	image.format = format;
+	image.width = base.width;
+	image.height = base.height;
+	image.levels = 1;
+	while (image.levelWidth(image.levels - 1) > 1 || image.levelHeight(image.levels - 1) > 1)
+		image.levels++;
+	image.data.resize(image.levelOffset(image.levels));
+
+	// the same Kaiser filtered chain the program builds for uncompressed images, alpha images are clamped
+	MipChain mips = generateMips(base.rgba.data(), base.width, base.height, 4, format == FORMAT_BC5 ? MIP_NORMAL : MIP_COLOR,
+		FILTER_KAISER, format != FORMAT_BC3, threads);
+	for (int l = 0; l < image.levels; l++)
+	{
+		Level level;
+		level.width = mips.levelWidth(l);
+		level.height = mips.levelHeight(l);
+		level.rgba.assign(mips.data.begin() + mips.levelOffset(l), mips.data.begin() + mips.levelOffset(l) + mips.levelSize(l));
+		encodeLevel(level, format, image.data.data() + image.levelOffset(l), threads);
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if (!writeDds(output, image)) {
+		std::cout << "Failed to write " << output << std::endl;
+		return 1;
+	}
+	const char* names[] = { "BC1", "BC3", "BC5" };
+	size_t uncompressed = 0;
+	for (int l = 0; l < image.levels; l++)
+		uncompressed += (size_t)image.levelWidth(l) * image.levelHeight(l) * (components == 4 || components == 2 ? 4 : 3);
+	std::cout << input << " -> " << output << ": " << names[format] << ", " << base.width << "x" << base.height << ", "
+		<< image.levels << " levels, " << image.data.size() / 1024 << " KiB (" << (double)uncompressed / image.data.size()
+		<< "x smaller than uncompressed), " << seconds * 1000.0 << " ms with " << threads << " threads, rmse "
+		<< encodingError(base, format, image.data.data()) << std::endl;
+	return 0;
+}